@@ -0,0 +1,286 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+import esphome.final_validate as fv
+from esphome import automation
+
+from esphome.components import light, remote_receiver, remote_transmitter, sensor
+from esphome.components.remote_base import CONF_RECEIVER_ID, CONF_TRANSMITTER_ID
+from esphome.const import (
+    CONF_ID,
+    CONF_LIGHT,
+    CONF_OUTPUT_ID,
+    CONF_PLATFORM,
+    CONF_TRIGGER_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+)
+from esphome.core import CORE, ID, EsphomeError
+
+CODEOWNERS = ["@chrisandreae"]
+DEPENDENCIES = ["remote_transmitter", "light"]
+
+CONF_EXTRA_TRANSMITTER_IDS = 'extra_transmitter_ids'
+CONF_TRANSMIT_INTERVAL = 'transmit_interval'
+CONF_MAX_BATCH_GAP = 'max_batch_gap'
+CONF_SYNC_GROUP = 'sync_group'
+CONF_BRIGHTNESS_HYSTERESIS = 'brightness_hysteresis'
+CONF_COLOR_TEMPERATURE_HYSTERESIS = 'color_temperature_hysteresis'
+CONF_ROUND_BRIGHTNESS = 'round_brightness'
+CONF_ON_TRANSMIT_COMPLETE = 'on_transmit_complete'
+CONF_TRACE_SIZE = 'trace_size'
+CONF_MINIMAL_FOOTPRINT = 'minimal_footprint'
+CONF_CALIBRATION_SENSOR_ID = 'calibration_sensor_id'
+CONF_FRAMES_SENT = 'frames_sent'
+CONF_BLOCKED_TIME = 'blocked_time'
+CONF_MAX_BLOCKED_TIME = 'max_blocked_time'
+CONF_QUEUE_DEPTH = 'queue_depth'
+CONF_RESYNCS = 'resyncs'
+CONF_SUPERSEDED = 'superseded'
+CONF_DROPPED_FRAMES = 'dropped_frames'
+CONF_FINISH_TIME = 'finish_time'
+CONF_SCENE_TIME = 'scene_time'
+
+# The light platforms built on this component
+IR_LIGHT_PLATFORMS = ('nec_light', 'sara_light', 'photo_light')
+
+def AUTO_LOAD():
+    # The sensor component is only pulled in for lights that configure
+    # telemetry sensors or calibrate against a light sensor
+    sensor_keys = (*TELEMETRY_SENSORS, CONF_CALIBRATION_SENSOR_ID)
+    lights = CORE.raw_config.get(CONF_LIGHT) or []
+    if isinstance(lights, dict):
+        lights = [lights]
+    for conf in lights:
+        if conf.get(CONF_PLATFORM) in IR_LIGHT_PLATFORMS and any(key in conf for key in sensor_keys):
+            return ['sensor']
+    return []
+
+ir_light_base_ns = cg.esphome_ns.namespace('ir_light_base')
+IrScheduler = ir_light_base_ns.class_('IrScheduler', cg.Component)
+IrLightOutputBase = ir_light_base_ns.class_('IrLightOutputBase', cg.Component, light.LightOutput)
+TransmitCompleteTrigger = ir_light_base_ns.class_('TransmitCompleteTrigger', automation.Trigger.template())
+DumpTraceAction = ir_light_base_ns.class_('DumpTraceAction', automation.Action)
+CalibrateGapAction = ir_light_base_ns.class_('CalibrateGapAction', automation.Action)
+SensorGapFeedback = ir_light_base_ns.class_('SensorGapFeedback')
+
+DATA_SCHEDULERS = 'ir_light_base_schedulers'
+DATA_SYNC_GROUPS = 'ir_light_base_sync_groups'
+
+def _counter_schema(icon):
+    return sensor.sensor_schema(
+        icon=icon,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+def _blocked_time_schema(state_class):
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        icon='mdi:timer-sand',
+        accuracy_decimals=1,
+        state_class=state_class,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+def _duration_schema(icon):
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        icon=icon,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+IR_LIGHT_SCHEMA = light.RGB_LIGHT_SCHEMA.extend({
+    cv.GenerateID(CONF_TRANSMITTER_ID): cv.use_id(remote_transmitter.RemoteTransmitterComponent),
+    # Send every frame on these transmitters too, for lights out of reach of
+    # a single emitter. Lights sharing a transmitter must share all of them.
+    cv.Optional(CONF_EXTRA_TRANSMITTER_IDS): cv.ensure_list(cv.use_id(remote_transmitter.RemoteTransmitterComponent)),
+    # Track commands sent by the light's own remote
+    cv.Optional(CONF_RECEIVER_ID): cv.use_id(remote_receiver.RemoteReceiverComponent),
+    # Collapse intermediate transition states so that at most one state is
+    # transmitted per interval
+    cv.Optional(CONF_TRANSMIT_INTERVAL): cv.positive_time_period_milliseconds,
+    # Frames separated by at most this gap are sent in one transmission,
+    # saving the setup of a transmission per frame. The transmitter blocks
+    # the main loop for the whole batch, gaps included, so this is off
+    # unless set.
+    cv.Optional(CONF_MAX_BATCH_GAP): cv.positive_time_period_milliseconds,
+    # Lights on the same transmitter with the same sync group step together,
+    # for example the channel 1 and channel 2 lights of one room
+    cv.Optional(CONF_SYNC_GROUP): cv.string_strict,
+    # Keep the device at its current level until the light's value moves this
+    # far past the level's boundary, so values hovering around a boundary
+    # don't make the device flap between levels
+    cv.Optional(CONF_BRIGHTNESS_HYSTERESIS): cv.percentage,
+    # In mireds
+    cv.Optional(CONF_COLOR_TEMPERATURE_HYSTERESIS): cv.positive_float,
+    # Round brightness to the nearest level instead of truncating
+    cv.Optional(CONF_ROUND_BRIGHTNESS): cv.boolean,
+    # Record the last trace_size light states and the commands planned for
+    # them, for ir_light_base.dump_trace to log
+    cv.Optional(CONF_TRACE_SIZE): cv.int_range(min=0, max=1000),
+    # Build every IR light for the smallest RAM use, for ESP8266 nodes: frames
+    # are encoded as they're sent instead of kept as timing tables, and the
+    # per-state debug logs only exist at verbose log level. This is a build
+    # wide switch, so every IR light has to set it the same.
+    cv.Optional(CONF_MINIMAL_FOOTPRINT): cv.boolean,
+    # Feedback for ir_light_base.calibrate_gap: a light sensor watching the
+    # fixture. Every reading waits for the sensor's next update, so a shorter
+    # update_interval makes calibration quicker.
+    cv.Optional(CONF_CALIBRATION_SENSOR_ID): cv.use_id(sensor.Sensor),
+    # Runs once the light's frames have all been sent
+    cv.Optional(CONF_ON_TRANSMIT_COMPLETE): automation.validate_automation({
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(TransmitCompleteTrigger),
+    }),
+
+    # Optional telemetry sensors
+    cv.Optional(CONF_FRAMES_SENT): _counter_schema('mdi:remote'),
+    cv.Optional(CONF_BLOCKED_TIME): _blocked_time_schema(STATE_CLASS_TOTAL_INCREASING),
+    cv.Optional(CONF_MAX_BLOCKED_TIME): _blocked_time_schema(STATE_CLASS_MEASUREMENT),
+    cv.Optional(CONF_QUEUE_DEPTH): sensor.sensor_schema(
+        icon='mdi:tray-full',
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    cv.Optional(CONF_RESYNCS): _counter_schema('mdi:sync-alert'),
+    cv.Optional(CONF_SUPERSEDED): _counter_schema('mdi:skip-next'),
+    cv.Optional(CONF_DROPPED_FRAMES): _counter_schema('mdi:delete-sweep'),
+    # Time from the start of a scene, the frames queued by lights on the
+    # transmitter until it goes idle, to this light's last frame and to the
+    # end of the scene
+    cv.Optional(CONF_FINISH_TIME): _duration_schema('mdi:timer-check'),
+    cv.Optional(CONF_SCENE_TIME): _duration_schema('mdi:timer-outline'),
+  }).extend(cv.COMPONENT_SCHEMA)
+
+TELEMETRY_SENSORS = {
+    CONF_FRAMES_SENT: 'set_frames_sent_sensor',
+    CONF_BLOCKED_TIME: 'set_blocked_time_sensor',
+    CONF_MAX_BLOCKED_TIME: 'set_max_blocked_time_sensor',
+    CONF_QUEUE_DEPTH: 'set_queue_depth_sensor',
+    CONF_RESYNCS: 'set_resyncs_sensor',
+    CONF_SUPERSEDED: 'set_superseded_sensor',
+    CONF_DROPPED_FRAMES: 'set_dropped_frames_sensor',
+    CONF_FINISH_TIME: 'set_finish_time_sensor',
+    CONF_SCENE_TIME: 'set_scene_time_sensor',
+}
+
+def final_validate_ir_light(config):
+    # minimal_footprint switches how all IR lights are built, so a light that
+    # disagrees with the others would silently be built the other way
+    lights = fv.full_config.get().get(CONF_LIGHT, [])
+    minimal = {
+        conf.get(CONF_MINIMAL_FOOTPRINT, False)
+        for conf in lights if conf.get(CONF_PLATFORM) in IR_LIGHT_PLATFORMS
+    }
+    if len(minimal) > 1:
+        raise cv.Invalid(
+            f"'{CONF_MINIMAL_FOOTPRINT}' applies to every IR light in the build, set it the same on all of them",
+            path=[CONF_MINIMAL_FOOTPRINT],
+        )
+    return config
+
+async def get_scheduler(transmitter_ids):
+    """Return the scheduler shared by every IR light on a set of transmitters,
+    creating it the first time the set is used."""
+    unique_ids = {transmitter_id.id: transmitter_id for transmitter_id in transmitter_ids}
+    key = frozenset(unique_ids)
+    schedulers = CORE.data.setdefault(DATA_SCHEDULERS, {})
+    if key in schedulers:
+        return schedulers[key]
+
+    # Two schedulers driving one transmitter would talk over each other
+    for other in schedulers:
+        shared = key & other
+        if shared:
+            raise EsphomeError(
+                f"Transmitter '{sorted(shared)[0]}' is used by IR lights with different "
+                f"sets of transmitters, lights sharing a transmitter must share all of them"
+            )
+
+    scheduler_id = ID(f'{"_".join(unique_ids)}_ir_scheduler', is_declaration=True, type=IrScheduler)
+    var = cg.new_Pvariable(scheduler_id)
+    schedulers[key] = var
+    cg.add(cg.App.register_component(var))
+
+    for transmitter_id in unique_ids.values():
+        transmitter = await cg.get_variable(transmitter_id)
+        cg.add(var.add_transmitter(transmitter))
+    return var
+
+async def register_ir_light(var, config):
+    await cg.register_component(var, config)
+
+    scheduler = await get_scheduler([config[CONF_TRANSMITTER_ID], *config.get(CONF_EXTRA_TRANSMITTER_IDS, [])])
+    cg.add(var.set_scheduler(scheduler))
+    if CONF_TRANSMIT_INTERVAL in config:
+        cg.add(var.set_transmit_interval(config[CONF_TRANSMIT_INTERVAL]))
+    if CONF_MAX_BATCH_GAP in config:
+        cg.add(var.set_max_batch_gap(config[CONF_MAX_BATCH_GAP]))
+
+    if CONF_BRIGHTNESS_HYSTERESIS in config:
+        cg.add(var.set_brightness_hysteresis(config[CONF_BRIGHTNESS_HYSTERESIS]))
+    if CONF_COLOR_TEMPERATURE_HYSTERESIS in config:
+        cg.add(var.set_color_hysteresis(config[CONF_COLOR_TEMPERATURE_HYSTERESIS]))
+    if CONF_ROUND_BRIGHTNESS in config:
+        cg.add(var.set_round_brightness(config[CONF_ROUND_BRIGHTNESS]))
+
+    if CONF_TRACE_SIZE in config:
+        cg.add(var.set_trace_size(config[CONF_TRACE_SIZE]))
+    if config.get(CONF_MINIMAL_FOOTPRINT, False):
+        cg.add_define('USE_IR_LIGHT_MINIMAL')
+
+    if CONF_SYNC_GROUP in config:
+        groups = CORE.data.setdefault(DATA_SYNC_GROUPS, {})
+        group = groups.setdefault(config[CONF_SYNC_GROUP], len(groups) + 1)
+        cg.add(var.set_sync_group(group))
+
+    if CONF_RECEIVER_ID in config:
+        receiver = await cg.get_variable(config[CONF_RECEIVER_ID])
+        cg.add(receiver.register_listener(var))
+
+    if CONF_CALIBRATION_SENSOR_ID in config:
+        feedback_name = f'{config[CONF_OUTPUT_ID].id}_gap_feedback'
+        feedback = cg.new_Pvariable(ID(feedback_name, is_declaration=True, type=SensorGapFeedback))
+        sens = await cg.get_variable(config[CONF_CALIBRATION_SENSOR_ID])
+        cg.add(feedback.set_sensor(sens))
+        cg.add(var.set_gap_feedback(feedback))
+
+    for conf in config.get(CONF_ON_TRANSMIT_COMPLETE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [], conf)
+
+    for key, setter in TELEMETRY_SENSORS.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, setter)(sens))
+
+    await light.register_light(var, config)
+
+@automation.register_action(
+    'ir_light_base.dump_trace',
+    DumpTraceAction,
+    automation.maybe_simple_id({
+        cv.Required(CONF_ID): cv.use_id(IrLightOutputBase),
+    }),
+)
+async def dump_trace_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+@automation.register_action(
+    'ir_light_base.calibrate_gap',
+    CalibrateGapAction,
+    automation.maybe_simple_id({
+        cv.Required(CONF_ID): cv.use_id(IrLightOutputBase),
+    }),
+)
+async def calibrate_gap_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
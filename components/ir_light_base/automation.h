@@ -0,0 +1,25 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "ir_light_output.h"
+
+namespace esphome {
+  namespace ir_light_base {
+    class TransmitCompleteTrigger : public Trigger<> {
+    public:
+      explicit TransmitCompleteTrigger(IrLightOutputBase *parent) {
+        parent->add_on_transmit_complete_callback([this]() { this->trigger(); });
+      }
+    };
+
+    template<typename... Ts> class DumpTraceAction : public Action<Ts...>, public Parented<IrLightOutputBase> {
+    public:
+      void play(Ts... x) override { this->parent_->dump_trace(); }
+    };
+
+    template<typename... Ts> class CalibrateGapAction : public Action<Ts...>, public Parented<IrLightOutputBase> {
+    public:
+      void play(Ts... x) override { this->parent_->calibrate_gap(); }
+    };
+  }
+}
@@ -0,0 +1,52 @@
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "gap_calibration.h"
+
+namespace esphome {
+  namespace ir_light_base {
+    static const char *TAG = "ir_light_base";
+
+    void GapSearch::begin(uint16_t min_gap, uint16_t max_gap, uint8_t confirmations) {
+      low_ = min_gap;
+      high_ = max_gap;
+      confirmations_ = confirmations;
+      passes_ = 0;
+    }
+
+    void GapSearch::report(bool passed) {
+      if (!passed) {
+        low_ = gap() + 1;
+        passes_ = 0;
+        return;
+      }
+      if (++passes_ >= confirmations_) {
+        high_ = gap();
+        passes_ = 0;
+      }
+    }
+
+#ifdef USE_SENSOR
+    void SensorGapFeedback::set_sensor(sensor::Sensor *sensor) {
+      sensor_ = sensor;
+      sensor_->add_on_state_callback([this](float state) {
+        has_reading_ = true;
+        reading_time_ = millis();
+      });
+    }
+
+    bool SensorGapFeedback::has_reading_since(uint32_t time) {
+      return has_reading_ && (int32_t) (reading_time_ - time) >= 0;
+    }
+
+    void SensorGapFeedback::reference() {
+      reference_ = sensor_->state;
+      ESP_LOGD(TAG, "Reference light level: %.1f", reference_);
+    }
+
+    bool SensorGapFeedback::trial_passed(bool lit) {
+      ESP_LOGD(TAG, "Light level: %.1f", sensor_->state);
+      return (sensor_->state >= reference_ / 2.0f) == lit;
+    }
+#endif
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+
+namespace esphome {
+  namespace ir_light_base {
+    // Binary search for the shortest gap between frames that the device still
+    // reliably takes. Gaps are tried from the middle of the range; a gap is
+    // accepted once it passes `confirmations` trials in a row, and a single
+    // failure rules it and everything below it out. Only the search is kept
+    // here, so it can be driven by any source of trial outcomes.
+    class GapSearch {
+    public:
+      // Search [min_gap, max_gap], with max_gap taken to be safe
+      void begin(uint16_t min_gap, uint16_t max_gap, uint8_t confirmations);
+      bool done() const { return low_ >= high_; }
+      // The gap to try next
+      uint16_t gap() const { return low_ + (high_ - low_) / 2; }
+      void report(bool passed);
+      // The shortest gap that passed, once done()
+      uint16_t result() const { return high_; }
+
+    protected:
+      uint16_t low_{0};
+      uint16_t high_{0};
+      uint8_t confirmations_{1};
+      uint8_t passes_{0};
+    };
+
+    // Tells whether the fixture took the last frame of a calibration trial,
+    // which turns the light on or off
+    class GapFeedback {
+    public:
+      // Whether a reading was taken at or after millis() `time`. Readings
+      // are only used once the light has settled after the last frame, so a
+      // source that lags behind the light has to catch up first.
+      virtual bool has_reading_since(uint32_t time) { return true; }
+      // Called with the light settled on in the state trials return it to,
+      // before the first trial
+      virtual void reference() {}
+      // Called once the trial's frames have been sent and the light has
+      // settled, with whether the last frame turned it on
+      virtual bool trial_passed(bool lit) = 0;
+    };
+
+#ifdef USE_SENSOR
+    // Reads a light sensor next to the fixture. The light counts as on when
+    // the reading is at least half the reference reading.
+    class SensorGapFeedback : public GapFeedback {
+    public:
+      void set_sensor(sensor::Sensor *sensor);
+      bool has_reading_since(uint32_t time) override;
+      void reference() override;
+      bool trial_passed(bool lit) override;
+
+    protected:
+      sensor::Sensor *sensor_{nullptr};
+      float reference_{0.0f};
+      // Whether the sensor has published, and millis() when it last did
+      bool has_reading_{false};
+      uint32_t reading_time_{0};
+    };
+#endif
+  }
+}
@@ -0,0 +1,371 @@
+#include "esphome/core/log.h"
+#include "esphome/core/hal.h"
+#include "ir_light_output.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+namespace esphome {
+  namespace ir_light_base {
+    static const char *TAG = "ir_light_base";
+
+    // While frames are still going out, publish telemetry at most this often
+    static const uint32_t TELEMETRY_PUBLISH_INTERVAL = 1000;
+
+    // The tracked device state is saved once it has been left alone this long,
+    // so a transition or a burst of changes costs a single preferences write
+    static const uint32_t PERSIST_DELAY = 5000;
+
+    // Frames received this soon after a transmission are taken to be the
+    // transmitter's own frames seen by the receiver
+    static const uint32_t ECHO_WINDOW = 250;
+
+    // NEC repeat codes follow each other every 108 ms while a button is held,
+    // a longer pause ends the hold
+    static const uint32_t HOLD_TIMEOUT = 150;
+
+    // Time for the light to settle after a calibration trial's frames are
+    // out, before the feedback is read
+    static const uint32_t CALIBRATION_SETTLE_TIME = 2000;
+    // How long after settling to wait for a reading taken since, before the
+    // reference is given up on or the trial fails. Light sensors commonly
+    // publish once a minute.
+    static const uint32_t CALIBRATION_READING_TIMEOUT = 150000;
+    // Calibration searches gaps from this up to the device's default gap
+    static const uint16_t CALIBRATION_MIN_GAP = 10;
+    // Trials a gap has to pass in a row to be accepted
+    static const uint8_t CALIBRATION_CONFIRMATIONS = 3;
+    // Added to the shortest gap that passed, as gaps on air can come up to a
+    // main loop interval late, never early
+    static const uint16_t CALIBRATION_MARGIN = 20;
+
+    static const char *const COMMAND_TYPE_NAMES[NUM_COMMAND_TYPES] = {"power", "absolute", "relative"};
+
+    void IrLightOutputBase::write_state(light::LightState *state) {
+      if (state_pending_) {
+        superseded_++;
+        telemetry_dirty_ = true;
+      }
+      state_ = state;
+      state_pending_ = true;
+
+      if (trace_.enabled()) {
+        float brightness;
+        state->current_values_as_brightness(&brightness);
+        TraceRecord *record = trace_.add();
+        record->time = millis();
+        record->mireds = state->current_values.get_color_temperature();
+        record->brightness = brightness * 65535.0f;
+      }
+    }
+
+    void IrLightOutputBase::dump_trace() {
+      if (!trace_.enabled()) {
+        ESP_LOGW(TAG, "Tracing is not enabled for this light");
+        return;
+      }
+      trace_.dump(TAG);
+    }
+
+    void IrLightOutputBase::trace_commands_(const std::vector<IrCommand> &commands) {
+      TraceRecord *record = trace_.last();
+      if (record == nullptr) {
+        return;
+      }
+      record->applied = true;
+      record->command_count = commands.size() < UINT8_MAX ? commands.size() : UINT8_MAX;
+      for (size_t i = 0; i < commands.size() && i < TRACE_COMMANDS; ++i) {
+        record->commands[i] = commands[i].command;
+      }
+    }
+
+    void IrLightOutputBase::loop() {
+      if (telemetry_dirty_) {
+        publish_telemetry_();
+      }
+
+      if (persist_pending_ && millis() - last_state_change_ >= PERSIST_DELAY && scheduler_->is_idle(this)) {
+        persist_pending_ = false;
+        save_state_();
+      }
+
+      // Light states wait until calibration is done
+      if (calibration_phase_ != CALIBRATION_IDLE) {
+        calibration_loop_();
+        return;
+      }
+
+      if (!state_pending_) {
+        return;
+      }
+
+      // Frames already going out have to finish first
+      bool busy = !scheduler_->is_idle(this);
+      if (busy && scheduler_->is_sending(this)) {
+        return;
+      }
+
+      uint32_t now = millis();
+      if (has_applied_ && now - last_apply_time_ < transmit_interval_) {
+        return;
+      }
+
+      if (busy) {
+        // The tracked state only reflects frames that were sent, so the new
+        // plan starts from wherever the interrupted sequence got to
+        size_t dropped = scheduler_->cancel(this);
+        IR_LIGHT_LOG_STATE(TAG, "Preempting %u queued frames with newer state", (unsigned) dropped);
+        dropped_frames_ += dropped;
+      }
+
+      state_pending_ = false;
+      has_applied_ = true;
+      last_apply_time_ = now;
+
+      uint32_t start = micros();
+      apply_state_(state_);
+      record_blocked_(micros() - start);
+    }
+
+    void IrLightOutputBase::calibrate_gap() {
+      if (gap_feedback_ == nullptr) {
+        ESP_LOGW(TAG, "Gap calibration needs a calibration sensor");
+        return;
+      }
+      if (calibration_phase_ != CALIBRATION_IDLE) {
+        ESP_LOGW(TAG, "Gap calibration already running");
+        return;
+      }
+      ESP_LOGI(TAG, "Starting gap calibration");
+      calibration_phase_ = CALIBRATION_REFERENCE;
+      calibration_time_ = millis();
+    }
+
+    void IrLightOutputBase::calibration_loop_() {
+      // Every phase waits for the light's frames to go out and the light to
+      // settle
+      uint32_t now = millis();
+      if (!scheduler_->is_idle(this)) {
+        calibration_time_ = now;
+        return;
+      }
+      if (now - calibration_time_ < CALIBRATION_SETTLE_TIME) {
+        return;
+      }
+      // The reference and trials are read from a reading taken once the
+      // light settled, not one left over from before the frames
+      bool has_reading = gap_feedback_->has_reading_since(calibration_time_ + CALIBRATION_SETTLE_TIME);
+      bool timed_out = now - calibration_time_ >= CALIBRATION_SETTLE_TIME + CALIBRATION_READING_TIMEOUT;
+      if (!has_reading && !timed_out && calibration_phase_ != CALIBRATION_RESTORE) {
+        return;
+      }
+
+      switch (calibration_phase_) {
+      case CALIBRATION_REFERENCE:
+        if (!has_reading) {
+          calibration_phase_ = CALIBRATION_IDLE;
+          ESP_LOGW(TAG, "Gap calibration got no reading from the calibration sensor");
+          return;
+        }
+        if (!begin_calibration_()) {
+          calibration_phase_ = CALIBRATION_IDLE;
+          ESP_LOGW(TAG, "Gap calibration needs the light on in a known state");
+          return;
+        }
+        // Trials run with the gaps found so far, the default until then
+        for (uint16_t &gap : command_gaps_.gaps) {
+          gap = default_command_gap_();
+        }
+        gap_feedback_->reference();
+        calibration_type_ = 0;
+        gap_search_.begin(CALIBRATION_MIN_GAP, default_command_gap_(), CALIBRATION_CONFIRMATIONS);
+        next_gap_trial_();
+        return;
+      case CALIBRATION_TRIAL: {
+        // Trials leave the light in some other state, so every one is
+        // followed by setting it back
+        bool passed = has_reading && gap_feedback_->trial_passed(trial_lit_);
+        ESP_LOGD(TAG, "Gap %u ms after %s commands %s%s", (unsigned) gap_search_.gap(),
+                 COMMAND_TYPE_NAMES[calibration_type_], passed ? "passed" : "failed",
+                 has_reading ? "" : ", no reading");
+        gap_search_.report(passed);
+        restore_gap_trial_();
+        calibration_phase_ = CALIBRATION_RESTORE;
+        calibration_time_ = now;
+        return;
+      }
+      default:
+        next_gap_trial_();
+        return;
+      }
+    }
+
+    void IrLightOutputBase::next_gap_trial_() {
+      calibration_time_ = millis();
+      while (calibration_type_ < NUM_COMMAND_TYPES) {
+        command_type type = (command_type) calibration_type_;
+        if (!gap_search_.done()) {
+          if (queue_gap_trial_(type, gap_search_.gap(), &trial_lit_)) {
+            calibration_phase_ = CALIBRATION_TRIAL;
+            return;
+          }
+          ESP_LOGI(TAG, "No trial for the gap after %s commands, keeping %u ms", COMMAND_TYPE_NAMES[type],
+                   (unsigned) command_gaps_.gaps[type]);
+        } else {
+          // Only a gap the light sensor confirmed is kept, and never above
+          // the default
+          command_gaps_.gaps[type] = std::min<uint16_t>(gap_search_.result() + CALIBRATION_MARGIN,
+                                                        default_command_gap_());
+          ESP_LOGI(TAG, "Gap after %s commands is %u ms", COMMAND_TYPE_NAMES[type],
+                   (unsigned) command_gaps_.gaps[type]);
+        }
+        calibration_type_++;
+        gap_search_.begin(CALIBRATION_MIN_GAP, default_command_gap_(), CALIBRATION_CONFIRMATIONS);
+      }
+
+      save_command_gaps_();
+      calibration_phase_ = CALIBRATION_IDLE;
+      ESP_LOGI(TAG, "Gap calibration done");
+    }
+
+    bool IrLightOutputBase::on_receive(remote_base::RemoteReceiveData data) {
+      auto nec = remote_base::NECProtocol().decode(data);
+      // A repeat code on its own: a 9 ms mark, a 2.25 ms space and a bit mark
+      bool repeat = !nec.has_value() && data.peek_mark(9000) && data.peek_space(2250, 1) && data.peek_mark(560, 2);
+      if (!nec.has_value() && !repeat) {
+        return false;
+      }
+      uint32_t now = millis();
+      if (now - scheduler_->get_last_transmit() < ECHO_WINDOW) {
+        ESP_LOGV(TAG, "Ignoring echo of own transmission");
+        return false;
+      }
+      if (nec.has_value()) {
+        bool ours = on_nec_received(*nec);
+        // Any other frame ends a held button, even one for another device
+        holding_ = holding_ && ours;
+        return ours;
+      }
+
+      if (!holding_ || now - last_code_time_ > HOLD_TIMEOUT) {
+        holding_ = false;
+        return false;
+      }
+      last_code_time_ = now;
+      on_nec_repeat_();
+      return true;
+    }
+
+    void IrLightOutputBase::publish_device_state_(float brightness, float mireds) {
+      if (light_state_ == nullptr) {
+        return;
+      }
+
+      auto call = light_state_->make_call();
+      call.set_transition_length(0);
+      if (brightness == 0.0f) {
+        call.set_state(false);
+      } else {
+        // The profile describes the gamma corrected brightness it quantizes,
+        // so undo the correction the light applies
+        float gamma = light_state_->get_gamma_correct();
+        call.set_state(true);
+        call.set_brightness(gamma > 0.0f ? powf(brightness, 1.0f / gamma) : brightness);
+        call.set_color_temperature(mireds);
+      }
+      call.perform();
+    }
+
+    void IrLightOutputBase::state_changed_() {
+      persist_pending_ = true;
+      last_state_change_ = millis();
+    }
+
+    void IrLightOutputBase::on_frame_sent(const IrFrame &frame) {
+      frames_sent_++;
+      frame_sent_(frame);
+    }
+
+    void IrLightOutputBase::on_transmit(uint32_t transmit_us) { record_blocked_(transmit_us); }
+
+    void IrLightOutputBase::on_transmission_sent() {
+      if (scheduler_->is_idle(this)) {
+        transmit_complete_callback_.call();
+      }
+    }
+
+    void IrLightOutputBase::on_scene_complete(uint32_t finish_ms, uint32_t scene_ms) {
+      ESP_LOGV(TAG, "Finished %u ms into a %u ms scene", (unsigned) finish_ms, (unsigned) scene_ms);
+#ifdef USE_SENSOR
+      if (finish_time_sensor_ != nullptr) {
+        finish_time_sensor_->publish_state(finish_ms);
+      }
+      if (scene_time_sensor_ != nullptr) {
+        scene_time_sensor_->publish_state(scene_ms);
+      }
+#endif
+    }
+
+    void IrLightOutputBase::record_blocked_(uint32_t blocked_us) {
+      blocked_us_ += blocked_us;
+      if (blocked_us > max_blocked_us_) {
+        max_blocked_us_ = blocked_us;
+      }
+      telemetry_dirty_ = true;
+    }
+
+    void IrLightOutputBase::publish_telemetry_() {
+      // Publish once the light goes quiet, or periodically during long sequences
+      uint32_t now = millis();
+      if (!scheduler_->is_idle(this) && now - last_publish_time_ < TELEMETRY_PUBLISH_INTERVAL) {
+        return;
+      }
+      telemetry_dirty_ = false;
+      last_publish_time_ = now;
+
+#ifdef USE_SENSOR
+      if (frames_sent_sensor_ != nullptr) {
+        frames_sent_sensor_->publish_state(frames_sent_);
+      }
+      if (blocked_time_sensor_ != nullptr) {
+        blocked_time_sensor_->publish_state(blocked_us_ / 1000.0f);
+      }
+      if (max_blocked_time_sensor_ != nullptr) {
+        max_blocked_time_sensor_->publish_state(max_blocked_us_ / 1000.0f);
+      }
+      if (queue_depth_sensor_ != nullptr) {
+        queue_depth_sensor_->publish_state(scheduler_->queue_depth(this));
+      }
+      if (resyncs_sensor_ != nullptr) {
+        resyncs_sensor_->publish_state(resyncs_);
+      }
+      if (superseded_sensor_ != nullptr) {
+        superseded_sensor_->publish_state(superseded_);
+      }
+      if (dropped_frames_sensor_ != nullptr) {
+        dropped_frames_sensor_->publish_state(dropped_frames_);
+      }
+#endif
+    }
+
+    void IrLightOutputBase::dump_telemetry_() {
+      ESP_LOGCONFIG(TAG, "  Frames sent: %" PRIu32, frames_sent_);
+      ESP_LOGCONFIG(TAG, "  Blocked time: %.1f ms total, %.1f ms max",
+                    blocked_us_ / 1000.0f, max_blocked_us_ / 1000.0f);
+      ESP_LOGCONFIG(TAG, "  Resyncs: %" PRIu32, resyncs_);
+      ESP_LOGCONFIG(TAG, "  Superseded states: %" PRIu32 ", dropped frames: %" PRIu32, superseded_, dropped_frames_);
+#ifdef USE_SENSOR
+      LOG_SENSOR("  ", "Frames Sent", frames_sent_sensor_);
+      LOG_SENSOR("  ", "Blocked Time", blocked_time_sensor_);
+      LOG_SENSOR("  ", "Max Blocked Time", max_blocked_time_sensor_);
+      LOG_SENSOR("  ", "Queue Depth", queue_depth_sensor_);
+      LOG_SENSOR("  ", "Resyncs", resyncs_sensor_);
+      LOG_SENSOR("  ", "Superseded", superseded_sensor_);
+      LOG_SENSOR("  ", "Dropped Frames", dropped_frames_sensor_);
+      LOG_SENSOR("  ", "Finish Time", finish_time_sensor_);
+      LOG_SENSOR("  ", "Scene Time", scene_time_sensor_);
+#endif
+    }
+  }
+}
@@ -0,0 +1,534 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/light/light_output.h"
+#include "esphome/components/light/light_state.h"
+#include "esphome/components/remote_base/nec_protocol.h"
+#include "esphome/components/remote_base/remote_base.h"
+#include "gap_calibration.h"
+#include "ir_scheduler.h"
+#include "quantize.h"
+#include "trace.h"
+
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+
+// Logs made for every light state. Minimal builds only make them at verbose
+// level, so they and their float formatting are compiled out by default.
+#ifdef USE_IR_LIGHT_MINIMAL
+#define IR_LIGHT_LOG_STATE ESP_LOGV
+#else
+#define IR_LIGHT_LOG_STATE ESP_LOGD
+#endif
+
+namespace esphome {
+  namespace ir_light_base {
+    enum power_state {
+      POWER_UNKNOWN,
+      POWER_OFF,
+      POWER_ON,
+    };
+
+    // Kinds of command, each with its own gap before the light's next frame
+    enum command_type : uint8_t {
+      // Turning the device on or off
+      COMMAND_POWER,
+      // Setting a level or preset, whatever the device was at
+      COMMAND_ABSOLUTE,
+      // Stepping from the current level
+      COMMAND_RELATIVE,
+      NUM_COMMAND_TYPES,
+    };
+
+    // The gap in ms the device needs after each type of command
+    struct CommandGaps {
+      uint16_t gaps[NUM_COMMAND_TYPES];
+    };
+
+    // One step of a planned command sequence
+    struct IrCommand {
+      uint16_t command;
+      uint8_t repeats;
+    };
+
+    // Common base for lights driven over a shared IR scheduler.
+    //
+    // write_state() only records that the light state changed. The state is
+    // read and turned into frames from loop(). Frames still queued for an
+    // older state are dropped and the light replans from the state its sent
+    // frames reached, so the intermediate values of a transition collapse
+    // into the newest one.
+    //
+    // With a receiver attached, NEC frames and the repeat codes of held
+    // buttons from the light's own remote update the tracked device state, so
+    // the next plan starts from where the remote left the device.
+    class IrLightOutputBase : public light::LightOutput, public Component, public IrSchedulerClient,
+                              public remote_base::RemoteReceiverListener {
+    public:
+      void write_state(light::LightState *state) override;
+      void loop() override;
+      void on_frame_sent(const IrFrame &frame) override;
+      void on_transmit(uint32_t transmit_us) override;
+      void on_transmission_sent() override;
+      void on_scene_complete(uint32_t finish_ms, uint32_t scene_ms) override;
+      bool on_receive(remote_base::RemoteReceiveData data) override;
+      // Called whenever the last of the light's queued frames has been sent
+      void add_on_transmit_complete_callback(std::function<void()> &&callback) {
+        transmit_complete_callback_.add(std::move(callback));
+      }
+      // Handle a decoded NEC frame seen by the receiver, and any repeat codes
+      // decoded with it. Returns whether it was a command for this light.
+      virtual bool on_nec_received(const remote_base::NECData &data) = 0;
+      void set_scheduler(IrScheduler *scheduler) { scheduler_ = scheduler; }
+      // Minimum time between two transmitted states, 0 to send as soon as the
+      // scheduler is free
+      void set_transmit_interval(uint32_t transmit_interval) { transmit_interval_ = transmit_interval; }
+      // Longest inter-frame gap that is sent as part of one transmission
+      // rather than waited out in loop(), 0 to send every frame on its own
+      void set_max_batch_gap(uint32_t max_batch_gap) { max_batch_gap_ = max_batch_gap; }
+      uint32_t max_batch_gap() override { return max_batch_gap_; }
+      void set_brightness_hysteresis(float hysteresis) { quantize_options_.brightness_hysteresis = hysteresis; }
+      void set_color_hysteresis(float hysteresis) { quantize_options_.color_hysteresis = hysteresis; }
+      void set_round_brightness(bool round_brightness) { quantize_options_.round_brightness = round_brightness; }
+      void set_sync_group(uint32_t sync_group) { sync_group_ = sync_group; }
+      // Keep the last trace_size light states and the commands planned for
+      // them, 0 to disable tracing
+      void set_trace_size(size_t trace_size) { trace_.set_size(trace_size); }
+      void dump_trace();
+      uint32_t sync_group() override { return sync_group_; }
+      void set_gap_feedback(GapFeedback *gap_feedback) { gap_feedback_ = gap_feedback; }
+      // Search for the shortest gap after each type of command that the
+      // device reliably takes, by shortening the gap before a frame that
+      // turns the light on or off and checking it did, and keep the results
+      // in place of the device's default gap
+      void calibrate_gap();
+      bool is_calibrating() const { return calibration_phase_ != CALIBRATION_IDLE; }
+
+#ifdef USE_SENSOR
+      void set_frames_sent_sensor(sensor::Sensor *sensor) { frames_sent_sensor_ = sensor; }
+      void set_blocked_time_sensor(sensor::Sensor *sensor) { blocked_time_sensor_ = sensor; }
+      void set_max_blocked_time_sensor(sensor::Sensor *sensor) { max_blocked_time_sensor_ = sensor; }
+      void set_queue_depth_sensor(sensor::Sensor *sensor) { queue_depth_sensor_ = sensor; }
+      void set_resyncs_sensor(sensor::Sensor *sensor) { resyncs_sensor_ = sensor; }
+      void set_superseded_sensor(sensor::Sensor *sensor) { superseded_sensor_ = sensor; }
+      void set_dropped_frames_sensor(sensor::Sensor *sensor) { dropped_frames_sensor_ = sensor; }
+      void set_finish_time_sensor(sensor::Sensor *sensor) { finish_time_sensor_ = sensor; }
+      void set_scene_time_sensor(sensor::Sensor *sensor) { scene_time_sensor_ = sensor; }
+#endif
+
+    protected:
+      // Queue the frames that move the light to the given state
+      virtual void apply_state_(light::LightState *state) = 0;
+
+      // Called for each of this light's frames once it has been transmitted
+      virtual void frame_sent_(const IrFrame &frame) {}
+
+      // Publish a device state changed by the remote back to the light
+      void publish_device_state_(float brightness, float mireds);
+      // A repeat code from the remote, continuing the command last received
+      // for this light
+      virtual void on_nec_repeat_() = 0;
+
+      // Write the tracked device state to preferences
+      virtual void save_state_() {}
+      // Schedule a deferred save_state_()
+      void state_changed_();
+
+      void dump_telemetry_();
+
+      // Record the commands planned for the last traced state
+      void trace_commands_(const std::vector<IrCommand> &commands);
+
+      // Record the state calibration returns the light to after each trial.
+      // Returns false unless the light is on in a known state.
+      virtual bool begin_calibration_() = 0;
+      // Queue a calibration trial of the gap after a type of command: frames
+      // ending with one of that type and then, gap_ms later, a frame that
+      // turns the light on or off. Sets lit to whether the light is lit if
+      // that last frame was taken. Returns false if no such trial starts from
+      // the current state.
+      virtual bool queue_gap_trial_(command_type type, uint16_t gap_ms, bool *lit) = 0;
+      // Forget the device state, which a trial may have left wrong, and
+      // queue the frames setting the light back to where calibration started
+      virtual void restore_gap_trial_() = 0;
+      // The device's default gap, which calibration starts from
+      virtual uint16_t default_command_gap_() = 0;
+      virtual void save_command_gaps_() {}
+
+      IrScheduler *scheduler_{nullptr};
+      light::LightState *light_state_{nullptr};
+      uint32_t transmit_interval_{0};
+      uint32_t max_batch_gap_{0};
+      uint32_t sync_group_{0};
+      // Gap after each type of the light's own frames, the device default
+      // unless calibrated
+      CommandGaps command_gaps_{};
+      QuantizeOptions quantize_options_;
+      TraceBuffer trace_;
+
+      // Telemetry. These are plain counters, kept whether or not any sensors
+      // are configured. "Blocked" time is time the main loop spent on this
+      // light, planning or waiting on the transmitter.
+      uint32_t frames_sent_{0};
+      uint64_t blocked_us_{0};
+      uint32_t max_blocked_us_{0};
+      // Commands sent only to recover from an unknown device state
+      uint32_t resyncs_{0};
+      // States that were replaced by a newer one before being transmitted
+      uint32_t superseded_{0};
+      // Queued frames cancelled in favour of a newer state
+      uint32_t dropped_frames_{0};
+
+      // The remote's button last received for this light, held down while
+      // repeat codes keep coming
+      bool holding_{false};
+      uint16_t held_command_{0};
+      uint8_t held_repeats_{0};
+      uint32_t last_code_time_{0};
+
+    private:
+      void record_blocked_(uint32_t blocked_us);
+      void publish_telemetry_();
+      void calibration_loop_();
+      void next_gap_trial_();
+
+      enum CalibrationPhase {
+        CALIBRATION_IDLE,
+        // Waiting to take the reference reading
+        CALIBRATION_REFERENCE,
+        CALIBRATION_TRIAL,
+        // Setting the light back after a failed trial
+        CALIBRATION_RESTORE,
+      };
+
+      light::LightState *state_{nullptr};
+      bool state_pending_{false};
+      bool has_applied_{false};
+      uint32_t last_apply_time_{0};
+
+      CallbackManager<void()> transmit_complete_callback_;
+
+      GapFeedback *gap_feedback_{nullptr};
+      GapSearch gap_search_;
+      CalibrationPhase calibration_phase_{CALIBRATION_IDLE};
+      // millis() when the light's frames were last seen going out
+      uint32_t calibration_time_{0};
+      // The command type being calibrated, and whether its current trial
+      // leaves the light lit
+      uint8_t calibration_type_{0};
+      bool trial_lit_{false};
+
+      bool persist_pending_{false};
+      uint32_t last_state_change_{0};
+
+      bool telemetry_dirty_{false};
+      uint32_t last_publish_time_{0};
+
+#ifdef USE_SENSOR
+      sensor::Sensor *frames_sent_sensor_{nullptr};
+      sensor::Sensor *blocked_time_sensor_{nullptr};
+      sensor::Sensor *max_blocked_time_sensor_{nullptr};
+      sensor::Sensor *queue_depth_sensor_{nullptr};
+      sensor::Sensor *resyncs_sensor_{nullptr};
+      sensor::Sensor *superseded_sensor_{nullptr};
+      sensor::Sensor *dropped_frames_sensor_{nullptr};
+      sensor::Sensor *finish_time_sensor_{nullptr};
+      sensor::Sensor *scene_time_sensor_{nullptr};
+#endif
+    };
+
+    // An IR light described entirely by a compile-time device profile:
+    //
+    //   State            the device state the driver tracks; a default
+    //                    constructed State is unknown, and known() says
+    //                    whether it can be planned from
+    //   TAG, NAME        log tag and dump_config() description
+    //   MIN_MIREDS, MAX_MIREDS
+    //   COMMAND_GAP      ms the device needs after a frame, before calibration
+    //   FRAME_TABLE_BYTES
+    //                    size of the precomputed frame tables, kept in flash
+    //                    on ESP8266
+    //   quantize(state, previous, options)
+    //                    the State the device should be in for the light's
+    //                    current values, given the State it is in
+    //   plan(from, to, commands)
+    //                    append the commands moving the device from one State
+    //                    to another, nothing if they are equal
+    //   apply(state, command)
+    //                    how a command changes the device State
+    //   frame(command, channel)
+    //                    the precomputed frame for a command
+    //   decode(code, channel, command)
+    //                    the command for a code seen by the receiver, false if
+    //                    it is not one of the device's codes on this channel
+    //   describe(state, options, brightness, mireds)
+    //                    light values quantizing back to a known State under
+    //                    the given options, with brightness 0 for off
+    //   off(state)       the State turning the device off leaves it in
+    //   command_type_of(command)
+    //                    which of the calibrated gaps follows the command
+    //   holdable(command)
+    //                    whether holding the command down repeats it, so that
+    //                    a run of it can be sent as one frame followed by NEC
+    //                    repeat codes
+    template<typename Profile> class IrLightOutput : public IrLightOutputBase {
+    public:
+      using State = typename Profile::State;
+
+      IrLightOutput() {
+        for (uint16_t &gap : command_gaps_.gaps) {
+          gap = Profile::COMMAND_GAP;
+        }
+      }
+
+      light::LightTraits get_traits() override {
+        auto traits = light::LightTraits();
+        traits.set_supported_color_modes({light::ColorMode::COLOR_TEMPERATURE});
+        traits.set_min_mireds(Profile::MIN_MIREDS);
+        traits.set_max_mireds(Profile::MAX_MIREDS);
+        return traits;
+      }
+
+      void dump_config() override {
+        ESP_LOGCONFIG(Profile::TAG, "%s", Profile::NAME);
+        ESP_LOGCONFIG(Profile::TAG, "  Channel: %u", channel_);
+        ESP_LOGCONFIG(Profile::TAG, "  Command gaps: power %u ms, absolute %u ms, relative %u ms",
+                      (unsigned) command_gaps_.gaps[COMMAND_POWER], (unsigned) command_gaps_.gaps[COMMAND_ABSOLUTE],
+                      (unsigned) command_gaps_.gaps[COMMAND_RELATIVE]);
+        ESP_LOGCONFIG(Profile::TAG, "  Frame tables: %u bytes", (unsigned) Profile::FRAME_TABLE_BYTES);
+        dump_telemetry_();
+      }
+
+      // The light's state is set up before it writes its first state, so the
+      // tracked device state restored here is what the first plan starts from
+      void setup_state(light::LightState *state) override {
+        light_state_ = state;
+        uint32_t hash = fnv1_hash(Profile::TAG) ^ state->get_object_id_hash();
+        pref_ = global_preferences->make_preference<State>(hash, true);
+        State restored;
+        if (pref_.load(&restored)) {
+          current_ = restored;
+        }
+
+        uint32_t gap_hash = fnv1_hash(std::string(Profile::TAG) + "_gaps") ^ state->get_object_id_hash();
+        gap_pref_ = global_preferences->make_preference<CommandGaps>(gap_hash, true);
+        CommandGaps gaps;
+        if (gap_pref_.load(&gaps)) {
+          command_gaps_ = gaps;
+        }
+      }
+
+      bool on_nec_received(const remote_base::NECData &data) override {
+        uint16_t command;
+        if (data.address != Profile::ADDRESS || !Profile::decode(data.command, channel_, &command)) {
+          return false;
+        }
+
+        ESP_LOGD(Profile::TAG, "Received command 0x%04X from remote", command);
+        // Repeat codes decoded along with the frame hold the button down
+        holding_ = true;
+        held_command_ = command;
+        held_repeats_ = std::min<uint16_t>(std::max<uint16_t>(data.command_repeats, 1) - 1, UINT8_MAX);
+        last_code_time_ = millis();
+        apply_command_(&current_, IrCommand{command, held_repeats_});
+        remote_changed_();
+        return true;
+      }
+
+      void set_channel(uint8_t channel) { channel_ = channel; }
+      // Number of NEC repeat codes the device takes as one more step of a held
+      // command, 0 to send every step as a frame of its own
+      void set_hold_repeats(uint8_t hold_repeats) { hold_repeats_ = hold_repeats; }
+
+    protected:
+      // A held button steps the device as often as the light's own held
+      // commands do
+      void on_nec_repeat_() override {
+        if (held_repeats_ == UINT8_MAX) {
+          return;
+        }
+        int steps = steps_(held_command_, held_repeats_);
+        held_repeats_++;
+        if (steps_(held_command_, held_repeats_) > steps) {
+          Profile::apply(&current_, held_command_);
+          remote_changed_();
+        }
+      }
+
+      void remote_changed_() {
+        state_changed_();
+        if (current_.known()) {
+          float brightness, mireds;
+          Profile::describe(current_, quantize_options_, &brightness, &mireds);
+          publish_device_state_(brightness, mireds);
+        }
+      }
+
+      void apply_state_(light::LightState *state) override {
+        State target = Profile::quantize(state, current_, quantize_options_);
+
+        if (!current_.known()) {
+          ESP_LOGD(Profile::TAG, "Current state unknown, starting from an absolute setting");
+          resyncs_++;
+        }
+
+        commands_.clear();
+        Profile::plan(current_, target, &commands_);
+        if (hold_repeats_ > 0) {
+          hold_commands_();
+        }
+        IR_LIGHT_LOG_STATE(Profile::TAG, "Channel %u: %u commands", channel_, (unsigned) commands_.size());
+        trace_commands_(commands_);
+        queue_commands_();
+      }
+
+      bool begin_calibration_() override {
+        if (!current_.known() || !is_lit_(current_)) {
+          return false;
+        }
+        trial_state_ = current_;
+        return true;
+      }
+
+      bool queue_gap_trial_(command_type type, uint16_t gap_ms, bool *lit) override {
+        // Turning the light off and back on tries the gaps before the frames
+        // switching it
+        State off = Profile::off(current_);
+        commands_.clear();
+        Profile::plan(current_, off, &commands_);
+        Profile::plan(off, current_, &commands_);
+        size_t trial = find_gap_trial_(current_, type, lit);
+
+        // Setting the state from unknown, turning the light off after each
+        // frame on the way, tries the gaps after the frames setting it
+        std::vector<IrCommand> steps;
+        Profile::plan(State{}, current_, &steps);
+        State reached{};
+        for (size_t i = 0; i < steps.size() && trial == NO_TRIAL; ++i) {
+          apply_command_(&reached, steps[i]);
+          commands_.assign(steps.begin(), steps.begin() + i + 1);
+          Profile::plan(reached, Profile::off(reached), &commands_);
+          trial = find_gap_trial_(State{}, type, lit);
+        }
+        if (trial == NO_TRIAL) {
+          return false;
+        }
+
+        for (size_t i = 0; i < commands_.size(); ++i) {
+          queue_command_(commands_[i], i == trial ? gap_ms : gap_after_(commands_[i].command));
+        }
+        return true;
+      }
+
+      void restore_gap_trial_() override {
+        current_ = State{};
+        commands_.clear();
+        Profile::plan(current_, trial_state_, &commands_);
+        queue_commands_();
+      }
+
+      uint16_t default_command_gap_() override { return Profile::COMMAND_GAP; }
+      void save_command_gaps_() override { gap_pref_.save(&command_gaps_); }
+
+      void queue_commands_() {
+        for (const IrCommand &command : commands_) {
+          queue_command_(command, gap_after_(command.command));
+        }
+      }
+
+      void queue_command_(const IrCommand &command, uint16_t gap_ms) {
+        scheduler_->enqueue(this, IrFrame{Profile::ADDRESS, command.command, Profile::frame(command.command, channel_),
+                                          gap_ms, command.repeats});
+      }
+
+      uint16_t gap_after_(uint16_t command) const { return command_gaps_.gaps[Profile::command_type_of(command)]; }
+
+      bool is_lit_(const State &state) const {
+        float brightness, mireds;
+        Profile::describe(state, quantize_options_, &brightness, &mireds);
+        return brightness > 0.0f;
+      }
+
+      // Cut the commands short after the first frame of the given type that
+      // is followed by one turning the light on or off, and return its index
+      size_t find_gap_trial_(State state, command_type type, bool *lit) {
+        for (size_t i = 0; i + 1 < commands_.size(); ++i) {
+          apply_command_(&state, commands_[i]);
+          if (Profile::command_type_of(commands_[i].command) != type || !state.known()) {
+            continue;
+          }
+          State next = state;
+          apply_command_(&next, commands_[i + 1]);
+          if (next.known() && is_lit_(next) != is_lit_(state)) {
+            commands_.resize(i + 2);
+            *lit = is_lit_(next);
+            return i;
+          }
+        }
+        return NO_TRIAL;
+      }
+
+      // The tracked state only advances as frames actually go out, so it stays
+      // right when queued frames are superseded
+      void frame_sent_(const IrFrame &frame) override {
+        apply_command_(&current_, IrCommand{frame.command, frame.repeats});
+        state_changed_();
+      }
+
+      void apply_command_(State *state, const IrCommand &command) const {
+        int steps = steps_(command.command, command.repeats);
+        for (int i = 0; i < steps; ++i) {
+          Profile::apply(state, command.command);
+        }
+      }
+
+      // How many times the device applies a command sent with repeats
+      int steps_(uint16_t command, uint8_t repeats) const {
+        if (hold_repeats_ > 0 && Profile::holdable(command)) {
+          return 1 + repeats / hold_repeats_;
+        }
+        return 1;
+      }
+
+      void save_state_() override { pref_.save(&current_); }
+
+      // Turn runs of the same holdable command into one command with repeats
+      void hold_commands_() {
+        size_t count = 0;
+        for (const IrCommand &command : commands_) {
+          if (count > 0 && Profile::holdable(command.command) && commands_[count - 1].command == command.command &&
+              commands_[count - 1].repeats + hold_repeats_ <= UINT8_MAX) {
+            commands_[count - 1].repeats += hold_repeats_;
+          } else {
+            commands_[count++] = command;
+          }
+        }
+        commands_.resize(count);
+      }
+
+      State current_{};
+      ESPPreferenceObject pref_;
+      ESPPreferenceObject gap_pref_;
+      // The state calibration returns the light to after each trial
+      State trial_state_{};
+      uint8_t channel_{1};
+      uint8_t hold_repeats_{0};
+      // Reused between plans to avoid reallocating
+      std::vector<IrCommand> commands_;
+
+      static const size_t NO_TRIAL = SIZE_MAX;
+    };
+  }
+}
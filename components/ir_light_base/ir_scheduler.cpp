@@ -0,0 +1,400 @@
+#include "esphome/core/log.h"
+#include "esphome/core/hal.h"
+#include "ir_scheduler.h"
+#include "pronto_frame.h"
+
+namespace esphome {
+  namespace ir_light_base {
+    static const char *TAG = "ir_light_base";
+
+    // Minimum spacing between any two frames on the transmitter, regardless
+    // of which light they belong to
+    static const uint32_t FRAME_SPACING = 10;
+
+    // Time from the first frame of a scene being queued to sending it, for the
+    // other lights changed at the same time to queue theirs
+    static const uint32_t SCENE_GATHER_TIME = 20;
+
+    // Upper bound on the frames packed into one transmission, which bounds
+    // how long a single transmission blocks the main loop
+    static const size_t MAX_BATCH_FRAMES = 4;
+
+    // NEC repeat codes start every 108ms, counted from the start of the frame
+    // or repeat code before them
+    static const uint32_t NEC_REPEAT_PERIOD_US = 108000;
+    constexpr static const char repeat_pronto_code[] = "0000 006D 0002 0000 0159 0057 0015 06C3";
+    static_assert(pronto_is_valid(repeat_pronto_code), "invalid NEC repeat Pronto code");
+    constexpr static const auto REPEAT_FRAME PROGMEM = parse_pronto<pronto_timing_count(repeat_pronto_code)>(repeat_pronto_code);
+    // The repeat code's trailing space is left out, the next code is timed
+    // from loop() instead
+    static const size_t REPEAT_LENGTH = sizeof(REPEAT_FRAME.data) / sizeof(REPEAT_FRAME.data[0]) - 1;
+
+    constexpr uint32_t repeat_code_duration() {
+      uint32_t duration = 0;
+      for (size_t i = 0; i < REPEAT_LENGTH; ++i) {
+        duration += REPEAT_FRAME.data[i] > 0 ? REPEAT_FRAME.data[i] : -REPEAT_FRAME.data[i];
+      }
+      return duration;
+    }
+
+    // Repeat codes on different transmitters are kept at least this far
+    // apart, a repeat code plus the time for the main loop to come round,
+    // so sending one doesn't delay the other
+    static const uint32_t REPEAT_SPACING_US = repeat_code_duration() + 2000;
+
+    void IrScheduler::loop() {
+      if (in_flight_) {
+        continue_flight_();
+        return;
+      }
+
+      if (scene_active_) {
+        check_scene_complete_();
+      }
+
+      uint32_t now = millis();
+      if (slots_.empty() || now - last_transmit_ < FRAME_SPACING || now - scene_start_ < SCENE_GATHER_TIME) {
+        return;
+      }
+
+      // Pick the ready light with the fewest frames left, round-robin among
+      // equals
+      size_t index = slots_.size();
+      for (size_t i = 0; i < slots_.size(); ++i) {
+        size_t candidate = (next_slot_ + i) % slots_.size();
+        if (is_ready_(slots_[candidate], now) &&
+            (index == slots_.size() || slots_[candidate].queue.size() < slots_[index].queue.size())) {
+          index = candidate;
+        }
+      }
+      if (index == slots_.size()) {
+        return;
+      }
+
+      batch_.clear();
+      take_frames_(index, slots_[index].client->max_batch_gap());
+
+      // Lights in the same sync group step together, so their ready frames
+      // go out in the same transmission. Repeat codes have to follow their
+      // frame directly, so frames with repeats aren't paired.
+      uint32_t group = slots_[index].client->sync_group();
+      if (group != 0 && batch_.back().frame.repeats == 0) {
+        for (size_t other = 0; other < slots_.size(); ++other) {
+          if (other != index && slots_[other].client->sync_group() == group && is_ready_(slots_[other], now) &&
+              slots_[other].queue.front().repeats == 0) {
+            take_frames_(other, 0);
+          }
+        }
+      }
+
+      next_slot_ = (index + 1) % slots_.size();
+      measure_batch_();
+      in_flight_ = true;
+      emit_next_ = 0;
+      if (emitters_.size() > 1 || batch_.back().frame.repeats > 0) {
+        high_freq_.start();
+      }
+      continue_flight_();
+    }
+
+    void IrScheduler::continue_flight_() {
+      // Repeat codes come first, they have to keep their cadence
+      bool sent_repeat = false;
+      for (auto &emitter : emitters_) {
+        uint32_t start = micros();
+        if (emitter.repeats_left == 0 || (int32_t) (start - emitter.code_start) < (int32_t) NEC_REPEAT_PERIOD_US) {
+          continue;
+        }
+        transmit_repeat_(emitter.transmitter);
+        emitter.code_start = start;
+        emitter.repeats_left--;
+        slots_[batch_.front().slot].client->on_transmit(micros() - start);
+        sent_repeat = true;
+      }
+      if (sent_repeat) {
+        return;
+      }
+
+      // Then the batch itself, on one emitter per loop
+      if (emit_next_ < emitters_.size()) {
+        uint32_t start = micros();
+        if (!batch_fits_(start)) {
+          return;
+        }
+        Emitter &emitter = emitters_[emit_next_++];
+        transmit_(emitter.transmitter, batch_);
+        slots_[batch_.front().slot].client->on_transmit(micros() - start);
+        emitter.code_start = start + last_code_offset_;
+        emitter.repeats_left = batch_.back().frame.repeats;
+        if (emit_next_ < emitters_.size()) {
+          return;
+        }
+      }
+
+      for (const auto &emitter : emitters_) {
+        if (emitter.repeats_left > 0) {
+          return;
+        }
+      }
+      finish_flight_();
+    }
+
+    bool IrScheduler::batch_fits_(uint32_t now) {
+      uint32_t code_start = now + last_code_offset_;
+      bool repeats = batch_.back().frame.repeats > 0;
+      for (const auto &emitter : emitters_) {
+        if (emitter.repeats_left == 0) {
+          continue;
+        }
+        // The batch has to be out before the emitter's next repeat code is
+        // due
+        uint32_t due = emitter.code_start + NEC_REPEAT_PERIOD_US;
+        if ((int32_t) (due - now) < (int32_t) (batch_us_ + REPEAT_SPACING_US)) {
+          return false;
+        }
+        // and the batch's own repeat codes must not come due at the same
+        // time as the emitter's
+        uint32_t phase = (code_start - emitter.code_start) % NEC_REPEAT_PERIOD_US;
+        if (repeats && (phase < REPEAT_SPACING_US || phase > NEC_REPEAT_PERIOD_US - REPEAT_SPACING_US)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    void IrScheduler::finish_flight_() {
+      in_flight_ = false;
+      high_freq_.stop();
+
+      last_transmit_ = millis();
+      for (const auto &entry : batch_) {
+        Slot &slot = slots_[entry.slot];
+        slot.last_sent = last_transmit_;
+        slot.finished_at = last_transmit_;
+        slot.gap_ms = entry.frame.gap_ms;
+      }
+
+      for (const auto &entry : batch_) {
+        slots_[entry.slot].client->on_frame_sent(entry.frame);
+      }
+      // Each client's frames are together in the batch
+      for (size_t i = 0; i < batch_.size(); ++i) {
+        if (i == 0 || batch_[i].slot != batch_[i - 1].slot) {
+          slots_[batch_[i].slot].client->on_transmission_sent();
+        }
+      }
+    }
+
+    void IrScheduler::check_scene_complete_() {
+      for (const auto &slot : slots_) {
+        if (!slot.queue.empty()) {
+          return;
+        }
+      }
+
+      scene_active_ = false;
+      uint32_t scene_ms = 0;
+      for (const auto &slot : slots_) {
+        if (slot.in_scene && slot.finished_at - scene_start_ > scene_ms) {
+          scene_ms = slot.finished_at - scene_start_;
+        }
+      }
+      ESP_LOGD(TAG, "Scene complete in %u ms", (unsigned) scene_ms);
+
+      for (auto &slot : slots_) {
+        if (slot.in_scene) {
+          slot.in_scene = false;
+          slot.client->on_scene_complete(slot.finished_at - scene_start_, scene_ms);
+        }
+      }
+    }
+
+    bool IrScheduler::is_ready_(const Slot &slot, uint32_t now) {
+      return !slot.queue.empty() && now - slot.last_sent >= slot.gap_ms;
+    }
+
+    void IrScheduler::take_frames_(size_t index, uint32_t max_batch_gap) {
+      // Take the frame along with any following frames that are only a short
+      // gap behind it
+      Slot &slot = slots_[index];
+      size_t count = 1;
+      while (count < slot.queue.size() && count < MAX_BATCH_FRAMES &&
+             slot.queue[count - 1].gap_ms <= max_batch_gap && slot.queue[count - 1].repeats == 0) {
+        count++;
+      }
+      for (size_t i = 0; i < count; ++i) {
+        batch_.push_back(Batched{index, slot.queue[i]});
+      }
+      slot.queue.erase(slot.queue.begin(), slot.queue.begin() + count);
+    }
+
+    void IrScheduler::dump_config() {
+      ESP_LOGCONFIG(TAG, "IR Light Scheduler");
+      ESP_LOGCONFIG(TAG, "  Transmitters: %u", (unsigned) emitters_.size());
+      ESP_LOGCONFIG(TAG, "  Lights: %u", (unsigned) slots_.size());
+    }
+
+    void IrScheduler::enqueue(IrSchedulerClient *client, const IrFrame &frame) {
+      Slot *slot = find_slot_(client);
+      if (slot == nullptr) {
+        slots_.push_back(Slot{client, {}, 0, 0, false, 0});
+        slot = &slots_.back();
+      }
+      if (!scene_active_) {
+        scene_active_ = true;
+        scene_start_ = millis();
+      }
+      if (!slot->in_scene) {
+        slot->in_scene = true;
+        slot->finished_at = scene_start_;
+      }
+      slot->queue.push_back(frame);
+    }
+
+    size_t IrScheduler::cancel(IrSchedulerClient *client) {
+      Slot *slot = find_slot_(client);
+      if (slot == nullptr) {
+        return 0;
+      }
+      // Frames already being sent can't be taken back
+      size_t dropped = slot->queue.size();
+      slot->queue.clear();
+      return dropped;
+    }
+
+    bool IrScheduler::is_idle(IrSchedulerClient *client) {
+      Slot *slot = find_slot_(client);
+      if (slot == nullptr) {
+        return true;
+      }
+      return slot->queue.empty() && !is_sending(client);
+    }
+
+    bool IrScheduler::is_sending(IrSchedulerClient *client) {
+      if (!in_flight_) {
+        return false;
+      }
+      for (const auto &entry : batch_) {
+        if (slots_[entry.slot].client == client) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    size_t IrScheduler::queue_depth(IrSchedulerClient *client) {
+      Slot *slot = find_slot_(client);
+      return slot == nullptr ? 0 : slot->queue.size();
+    }
+
+    IrScheduler::Slot *IrScheduler::find_slot_(IrSchedulerClient *client) {
+      for (auto &slot : slots_) {
+        if (slot.client == client) {
+          return &slot;
+        }
+      }
+      return nullptr;
+    }
+
+#ifdef USE_IR_LIGHT_MINIMAL
+    static uint32_t frame_duration(const NecFrameTimings &frame) {
+      uint32_t bits = table_read(&frame.bits);
+      uint32_t duration = NEC_HEADER_HIGH_US + NEC_HEADER_LOW_US + NEC_BIT_HIGH_US;
+      for (int bit = 0; bit < 32; ++bit) {
+        duration += NEC_BIT_HIGH_US + (((bits >> bit) & 1) ? NEC_BIT_ONE_LOW_US : NEC_BIT_ZERO_LOW_US);
+      }
+      return duration;
+    }
+
+    static void append_frame(remote_base::RemoteTransmitData *dst, const NecFrameTimings &frame) {
+      uint32_t bits = table_read(&frame.bits);
+      dst->mark(NEC_HEADER_HIGH_US);
+      dst->space(NEC_HEADER_LOW_US);
+      for (int bit = 0; bit < 32; ++bit) {
+        dst->mark(NEC_BIT_HIGH_US);
+        dst->space(((bits >> bit) & 1) ? NEC_BIT_ONE_LOW_US : NEC_BIT_ZERO_LOW_US);
+      }
+      dst->mark(NEC_BIT_HIGH_US);
+    }
+#else
+    static uint32_t frame_duration(const NecFrameTimings &frame) {
+      uint32_t duration = 0;
+      for (const int16_t &entry : frame.data) {
+        int16_t length = table_read(&entry);
+        duration += length > 0 ? length : -length;
+      }
+      return duration;
+    }
+
+    static void append_frame(remote_base::RemoteTransmitData *dst, const NecFrameTimings &frame) {
+      for (const int16_t &entry : frame.data) {
+        int16_t length = table_read(&entry);
+        if (length > 0) {
+          dst->mark(length);
+        } else {
+          dst->space(-length);
+        }
+      }
+    }
+#endif
+
+    uint32_t IrScheduler::gap_before_(const std::vector<Batched> &batch, size_t i) {
+      // A light's own frames keep its gap, other lights' frames only need
+      // the minimum spacing
+      return batch[i - 1].slot == batch[i].slot ? batch[i - 1].frame.gap_ms : FRAME_SPACING;
+    }
+
+    void IrScheduler::measure_batch_() {
+      uint32_t offset = 0;
+      for (size_t i = 0; i < batch_.size(); ++i) {
+        if (i > 0) {
+          offset += gap_before_(batch_, i) * 1000;
+        }
+        last_code_offset_ = offset;
+        offset += frame_duration(*batch_[i].frame.timings);
+      }
+      batch_us_ = offset;
+    }
+
+    void IrScheduler::transmit_(remote_base::RemoteTransmitterBase *transmitter, const std::vector<Batched> &batch) {
+      for (const auto &entry : batch) {
+        ESP_LOGV(TAG, "Sending NEC: address=0x%04X, command=0x%04X, repeats=%u",
+                 entry.frame.address, entry.frame.command, entry.frame.repeats);
+      }
+
+      // The transmit call fills the transmitter's own buffer, which keeps its
+      // capacity between calls, so sending doesn't allocate once it has grown
+      auto transmit = transmitter->transmit();
+      remote_base::RemoteTransmitData *dst = transmit.get_data();
+      dst->set_carrier_frequency(NEC_CARRIER_FREQUENCY);
+      dst->reserve(batch.size() * (1 + NEC_FRAME_LENGTH));
+
+      for (size_t i = 0; i < batch.size(); ++i) {
+        if (i > 0) {
+          dst->space(gap_before_(batch, i) * 1000);
+        }
+        append_frame(dst, *batch[i].frame.timings);
+      }
+
+      transmit.perform();
+      last_transmit_ = millis();
+    }
+
+    void IrScheduler::transmit_repeat_(remote_base::RemoteTransmitterBase *transmitter) {
+      auto transmit = transmitter->transmit();
+      remote_base::RemoteTransmitData *dst = transmit.get_data();
+      dst->set_carrier_frequency(NEC_CARRIER_FREQUENCY);
+      dst->reserve(REPEAT_LENGTH);
+      for (size_t i = 0; i < REPEAT_LENGTH; ++i) {
+        int32_t value = table_read(&REPEAT_FRAME.data[i]);
+        if (value > 0) {
+          dst->mark(value);
+        } else {
+          dst->space(-value);
+        }
+      }
+      transmit.perform();
+      last_transmit_ = millis();
+    }
+  }
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/remote_base/remote_base.h"
+#include "nec_frame.h"
+
+namespace esphome {
+  namespace ir_light_base {
+    // A single NEC frame queued by a light. gap_ms is the quiet time the
+    // receiving fixture needs before it will accept that light's next frame.
+    struct IrFrame {
+      uint16_t address;
+      uint16_t command;
+      // Precomputed timings for address and command
+      const NecFrameTimings *timings;
+      uint16_t gap_ms;
+      // Number of NEC repeat codes to send directly after the frame
+      uint8_t repeats { 0 };
+    };
+
+    class IrSchedulerClient {
+    public:
+      // Called once a frame queued by this client has been transmitted
+      virtual void on_frame_sent(const IrFrame &frame) = 0;
+      // Called after every call to a transmitter for the client whose frame
+      // leads the transmission, with the time the call blocked for. A batch
+      // with repeat codes, or sent on several transmitters, takes one call
+      // per loop.
+      virtual void on_transmit(uint32_t transmit_us) {}
+      // Called once per transmission for each client with frames in it,
+      // after on_frame_sent() has been called for all of them
+      virtual void on_transmission_sent() {}
+
+      // Frames followed by a gap of at most this many ms may be packed into a
+      // single transmission together with the client's next frame
+      virtual uint32_t max_batch_gap() { return 0; }
+
+      // Clients sharing a non-zero sync group have their ready frames sent in
+      // the same transmission, so the devices change together
+      virtual uint32_t sync_group() { return 0; }
+
+      // Called at the end of a scene for each client that queued frames in
+      // it, with the ms from the start of the scene to the client's last frame
+      // and to the end of the scene
+      virtual void on_scene_complete(uint32_t finish_ms, uint32_t scene_ms) {}
+    };
+
+    // Serializes the frames of every light sharing one IR transmitter. Each
+    // light's frames are sent in the order they were queued. Whenever the
+    // transmitter is free, the light with the fewest frames left among those
+    // ready to send goes next, so one light's inter-frame gaps are used to
+    // send the other lights' frames and short sequences finish first.
+    //
+    // A scene is everything sent from the transmitter going busy until it is
+    // idle again. Sending starts shortly after the first frame of a scene is
+    // queued, so the lights changed together get to plan first.
+    //
+    // Consecutive frames of one light separated by short gaps are sent as a
+    // single transmission, with the gaps encoded as spaces, saving the setup
+    // of one transmission per frame. The transmitter blocks for the whole
+    // batch, so only short gaps are worth packing this way.
+    //
+    // NEC repeat codes following a frame are sent one per loop at the
+    // protocol's 108ms cadence rather than in one long transmission, so the
+    // main loop is blocked for at most one code at a time.
+    //
+    // With several transmitters, every transmission is sent on each of them,
+    // one transmitter per loop, so the time the main loop blocks for at once
+    // doesn't grow with the number of transmitters. Frames count as sent
+    // once they, and their repeat codes, are out on every transmitter. A
+    // transmitter only starts on the batch if that leaves the repeat codes
+    // due on the others on time, otherwise it waits for them to finish.
+    class IrScheduler : public Component {
+    public:
+      // Only the generic transmitter interface is used, so any
+      // RemoteTransmitterBase implementation can stand in for the real one
+      void add_transmitter(remote_base::RemoteTransmitterBase *transmitter) {
+        emitters_.push_back(Emitter{transmitter, 0, 0});
+      }
+      void loop() override;
+      void dump_config() override;
+      float get_setup_priority() const override { return setup_priority::DATA; }
+
+      void enqueue(IrSchedulerClient *client, const IrFrame &frame);
+      // Drop all frames the client has queued but not yet sent, returning
+      // how many were dropped
+      size_t cancel(IrSchedulerClient *client);
+      bool is_idle(IrSchedulerClient *client);
+      // Whether frames of the client are part of the transmission going out
+      bool is_sending(IrSchedulerClient *client);
+      size_t queue_depth(IrSchedulerClient *client);
+      // millis() at the end of the most recent transmission, including each
+      // transmitter's copy of a batch and every repeat code
+      uint32_t get_last_transmit() const { return last_transmit_; }
+
+    protected:
+      struct Slot {
+        IrSchedulerClient *client;
+        std::vector<IrFrame> queue;
+        uint32_t last_sent;
+        uint16_t gap_ms;
+        // Whether the client queued frames in the current scene, and when its
+        // last frame in it was sent
+        bool in_scene;
+        uint32_t finished_at;
+      };
+
+      struct Batched {
+        size_t slot;
+        IrFrame frame;
+      };
+
+      struct Emitter {
+        remote_base::RemoteTransmitterBase *transmitter;
+        // micros() at the start of the last code sent on this transmitter
+        uint32_t code_start;
+        // Repeat codes still to send after the batch
+        uint8_t repeats_left;
+      };
+
+      Slot *find_slot_(IrSchedulerClient *client);
+      bool is_ready_(const Slot &slot, uint32_t now);
+      void check_scene_complete_();
+      // Move the slot's next frame, and any frames following it by at most
+      // max_batch_gap, into the current batch
+      void take_frames_(size_t index, uint32_t max_batch_gap);
+      // Space before the i-th frame of a batch, in ms
+      static uint32_t gap_before_(const std::vector<Batched> &batch, size_t i);
+      // Work out the length of the batch and where its last frame starts
+      void measure_batch_();
+      // Whether the batch can start on another transmitter now without
+      // delaying the repeat codes of the transmitters already sending
+      bool batch_fits_(uint32_t now);
+      void continue_flight_();
+      void finish_flight_();
+      void transmit_(remote_base::RemoteTransmitterBase *transmitter, const std::vector<Batched> &batch);
+      void transmit_repeat_(remote_base::RemoteTransmitterBase *transmitter);
+
+      std::vector<Emitter> emitters_;
+      std::vector<Slot> slots_;
+      // Frames going out in the current transmission, reused between
+      // transmissions
+      std::vector<Batched> batch_;
+      bool in_flight_{false};
+      // The transmitters before this one have sent the batch
+      size_t emit_next_{0};
+      size_t next_slot_{0};
+      uint32_t last_transmit_{0};
+      bool scene_active_{false};
+      uint32_t scene_start_{0};
+      // Length of the batch, and the offset from its start to its last
+      // frame, in microseconds
+      uint32_t batch_us_{0};
+      uint32_t last_code_offset_{0};
+      HighFrequencyLoopRequester high_freq_;
+    };
+  }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esphome/core/defines.h"
+#include "progmem_table.h"
+
+namespace esphome {
+  namespace ir_light_base {
+    // NEC timings, as used by remote_base::NECProtocol
+    static const uint32_t NEC_CARRIER_FREQUENCY = 38000;
+    static const int16_t NEC_HEADER_HIGH_US = 9000;
+    static const int16_t NEC_HEADER_LOW_US = 4500;
+    static const int16_t NEC_BIT_HIGH_US = 560;
+    static const int16_t NEC_BIT_ONE_LOW_US = 1690;
+    static const int16_t NEC_BIT_ZERO_LOW_US = 560;
+
+    // Header, 16 address and 16 command bits, stop mark
+    static const size_t NEC_FRAME_LENGTH = 2 + 32 * 2 + 1;
+
+#ifdef USE_IR_LIGHT_MINIMAL
+    // Minimal builds keep only the 32 bits of a frame, and expand them into
+    // timings as the frame is sent. A table entry is 4 bytes instead of 134.
+    struct NecFrameTimings {
+      uint32_t bits;
+    };
+
+    constexpr NecFrameTimings encode_nec_frame(uint16_t address, uint16_t command) {
+      return NecFrameTimings{address | ((uint32_t) command << 16)};
+    }
+#else
+    // Raw timings of one complete NEC frame in microseconds, marks positive
+    // and spaces negative, ready to be copied into a RemoteTransmitData.
+    struct NecFrameTimings {
+      int16_t data[NEC_FRAME_LENGTH];
+    };
+
+    constexpr NecFrameTimings encode_nec_frame(uint16_t address, uint16_t command) {
+      NecFrameTimings frame{};
+      size_t i = 0;
+      frame.data[i++] = NEC_HEADER_HIGH_US;
+      frame.data[i++] = -NEC_HEADER_LOW_US;
+
+      // Both words are sent least significant bit first
+      uint32_t bits = address | ((uint32_t) command << 16);
+      for (int bit = 0; bit < 32; ++bit) {
+        frame.data[i++] = NEC_BIT_HIGH_US;
+        frame.data[i++] = ((bits >> bit) & 1) ? -NEC_BIT_ONE_LOW_US : -NEC_BIT_ZERO_LOW_US;
+      }
+
+      frame.data[i++] = NEC_BIT_HIGH_US;
+      return frame;
+    }
+#endif
+
+    // Frames for a device's fixed set of commands, encoded at compile time so
+    // that sending a command is a table lookup and a copy. Tables are declared
+    // PROGMEM, so entries are read with table_read().
+    template<size_t N> struct NecFrameTable {
+      uint16_t commands[N];
+      NecFrameTimings frames[N];
+
+      const NecFrameTimings *find(uint16_t command) const {
+        for (size_t i = 0; i < N; ++i) {
+          if (table_read(&commands[i]) == command) {
+            return &frames[i];
+          }
+        }
+        return nullptr;
+      }
+    };
+
+    // Builds the table for the given commands. The optional transform maps
+    // each command to the code actually sent, for devices that encode
+    // something like a channel number into the command bits; lookups are
+    // still by the untransformed command.
+    template<size_t N, typename Transform>
+    constexpr NecFrameTable<N> make_nec_frame_table(uint16_t address, const uint16_t (&commands)[N], Transform transform) {
+      NecFrameTable<N> table{};
+      for (size_t i = 0; i < N; ++i) {
+        table.commands[i] = commands[i];
+        table.frames[i] = encode_nec_frame(address, transform(commands[i]));
+      }
+      return table;
+    }
+
+    template<size_t N>
+    constexpr NecFrameTable<N> make_nec_frame_table(uint16_t address, const uint16_t (&commands)[N]) {
+      return make_nec_frame_table(address, commands, [](uint16_t command) { return command; });
+    }
+  }
+}
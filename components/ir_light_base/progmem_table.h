@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esphome/core/hal.h"
+
+namespace esphome {
+  namespace ir_light_base {
+    // Reads an entry of a PROGMEM table. On ESP8266 such tables stay in
+    // flash, which only takes aligned 32-bit loads, so narrower entries are
+    // put together from bytes (the targets are all little-endian). Elsewhere
+    // PROGMEM is empty and these are plain reads.
+    inline uint8_t table_read(const uint8_t *entry) { return progmem_read_byte(entry); }
+
+    inline uint16_t table_read(const uint16_t *entry) {
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(entry);
+      return progmem_read_byte(bytes) | (progmem_read_byte(bytes + 1) << 8);
+    }
+
+    inline int16_t table_read(const int16_t *entry) {
+      return (int16_t) table_read(reinterpret_cast<const uint16_t *>(entry));
+    }
+
+    inline uint32_t table_read(const uint32_t *entry) { return *entry; }
+    inline int32_t table_read(const int32_t *entry) { return *entry; }
+    inline float table_read(const float *entry) { return *entry; }
+  }
+}
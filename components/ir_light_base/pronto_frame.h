@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+  namespace ir_light_base {
+    // Compile-time conversion of learned Pronto hex codes ("0000 FFFF NNNN
+    // RRRR ...") into raw timings, so that sending one never parses text.
+    //
+    // Usage:
+    //   constexpr const char CODE[] = "0000 006D 0002 0000 0159 0057 0015 06C3";
+    //   static_assert(pronto_is_valid(CODE), "bad Pronto code");
+    //   constexpr auto FRAME = parse_pronto<pronto_timing_count(CODE)>(CODE);
+
+    // Pronto durations are counted in carrier cycles, with the carrier period
+    // given in units of this many microseconds
+    static constexpr double PRONTO_CLOCK_US = 0.241246;
+
+    template<size_t N> struct ProntoTimings {
+      uint32_t carrier_frequency;
+      // Marks positive and spaces negative, in microseconds
+      int32_t data[N];
+    };
+
+    namespace pronto_detail {
+      constexpr bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n';
+      }
+
+      constexpr int hex_value(char c) {
+        return (c >= '0' && c <= '9') ? c - '0'
+             : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+             : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+             : -1;
+      }
+
+      constexpr size_t word_count(const char *code) {
+        size_t count = 0;
+        bool in_word = false;
+        for (const char *c = code; *c; ++c) {
+          if (is_space(*c)) {
+            in_word = false;
+          } else if (!in_word) {
+            in_word = true;
+            ++count;
+          }
+        }
+        return count;
+      }
+
+      // Returns the index-th whitespace separated hex word, or -1 if it isn't
+      // valid hex
+      constexpr int32_t word(const char *code, size_t index) {
+        const char *c = code;
+        for (size_t i = 0;; ++i) {
+          while (is_space(*c)) {
+            ++c;
+          }
+          if (i == index) {
+            break;
+          }
+          while (*c && !is_space(*c)) {
+            ++c;
+          }
+        }
+
+        int32_t value = 0;
+        for (; *c && !is_space(*c); ++c) {
+          int digit = hex_value(*c);
+          if (digit < 0) {
+            return -1;
+          }
+          value = value * 16 + digit;
+        }
+        return value;
+      }
+    }
+
+    constexpr size_t pronto_timing_count(const char *code) {
+      size_t words = pronto_detail::word_count(code);
+      return words > 4 ? words - 4 : 0;
+    }
+
+    // Only learned codes with a non-zero carrier are supported; the burst
+    // pair counts in the header have to match the data that follows.
+    constexpr bool pronto_is_valid(const char *code) {
+      size_t words = pronto_detail::word_count(code);
+      if (words < 4) {
+        return false;
+      }
+      for (size_t i = 0; i < words; ++i) {
+        if (pronto_detail::word(code, i) < 0) {
+          return false;
+        }
+      }
+      return pronto_detail::word(code, 0) == 0 && pronto_detail::word(code, 1) != 0 &&
+             (size_t) (pronto_detail::word(code, 2) + pronto_detail::word(code, 3)) * 2 == words - 4;
+    }
+
+    // Both the once and the repeat burst sequences are emitted, in order
+    template<size_t N> constexpr ProntoTimings<N> parse_pronto(const char *code) {
+      ProntoTimings<N> timings{};
+      double period_us = pronto_detail::word(code, 1) * PRONTO_CLOCK_US;
+      timings.carrier_frequency = (uint32_t) (1000000.0 / period_us + 0.5);
+      for (size_t i = 0; i < N; ++i) {
+        int32_t length = (int32_t) (pronto_detail::word(code, i + 4) * period_us + 0.5);
+        timings.data[i] = (i % 2 == 0) ? length : -length;
+      }
+      return timings;
+    }
+  }
+}
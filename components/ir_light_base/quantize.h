@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+
+#include "progmem_table.h"
+
+namespace esphome {
+  namespace ir_light_base {
+    // How light values are mapped to device levels
+    struct QuantizeOptions {
+      // How far past a level boundary the brightness (0-1) has to move before
+      // the device leaves its current level
+      float brightness_hysteresis{0.0f};
+      // The same for color temperature, in mireds
+      float color_hysteresis{0.0f};
+      // Round brightness to the nearest level instead of truncating
+      bool round_brightness{false};
+    };
+
+    namespace quantize_detail {
+      // Index of the level the value falls in, given the count boundaries
+      // between levels in increasing order. A value exactly on a boundary
+      // belongs to the level above, or below if inclusive. While the value
+      // is within hysteresis of the previous level's range, that level is
+      // kept.
+      template<typename Boundary>
+      int select(float value, int count, Boundary boundary, bool inclusive, int previous, float hysteresis) {
+        int index = 0;
+        for (int i = 0; i < count; ++i) {
+          index += inclusive ? value > boundary(i) : value >= boundary(i);
+        }
+        if (hysteresis <= 0.0f || previous < 0 || previous > count || index == previous) {
+          return index;
+        }
+
+        bool above_low = previous == 0 || value >= boundary(previous - 1) - hysteresis;
+        bool below_high = previous == count || value <= boundary(previous) + hysteresis;
+        return above_low && below_high ? previous : index;
+      }
+    }
+
+    // Index of the first threshold the value falls below (or at, if
+    // inclusive), or the number of thresholds if it is above all of them.
+    // The thresholds may be a PROGMEM table.
+    template<size_t N> inline int threshold_index(float value, const float (&thresholds)[N], bool inclusive = false) {
+      auto boundary = [&](int i) { return table_read(&thresholds[i]); };
+      return quantize_detail::select(value, N, boundary, inclusive, -1, 0.0f);
+    }
+
+    // As above, but sticking with the previous index (-1 if none) while the
+    // value stays within hysteresis of it
+    template<size_t N>
+    inline int threshold_index(float value, const float (&thresholds)[N], bool inclusive, int previous, float hysteresis) {
+      auto boundary = [&](int i) { return table_read(&thresholds[i]); };
+      return quantize_detail::select(value, N, boundary, inclusive, previous, hysteresis);
+    }
+
+    // Maps a value from 0 to 1 onto levels evenly sized levels, either
+    // truncating or rounding, with hysteresis around the previous level
+    inline int uniform_level(float value, int levels, bool round, int previous, float hysteresis) {
+      float offset = round ? 0.5f : 0.0f;
+      return quantize_detail::select(value, levels - 1, [&](int i) { return (i + 1 - offset) / levels; }, false,
+                                     previous, hysteresis);
+    }
+
+    // The range of values uniform_level() maps onto a level, from low up to
+    // but excluding high
+    inline void uniform_range(int level, int levels, bool round, float *low, float *high) {
+      float offset = round ? 0.5f : 0.0f;
+      *low = level == 0 ? 0.0f : (level - offset) / levels;
+      *high = level == levels - 1 ? 1.0f : (level + 1 - offset) / levels;
+    }
+
+    // The middle of a level's range, which maps back onto the level with or
+    // without hysteresis
+    inline float uniform_value(int level, int levels, bool round) {
+      float low, high;
+      uniform_range(level, levels, round, &low, &high);
+      return (low + high) / 2.0f;
+    }
+  }
+}
@@ -0,0 +1,44 @@
+#include "esphome/core/log.h"
+#include "trace.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace esphome {
+  namespace ir_light_base {
+    TraceRecord *TraceBuffer::add() {
+      TraceRecord *record = &records_[next_];
+      *record = TraceRecord{};
+      next_ = (next_ + 1) % records_.size();
+      if (count_ < records_.size()) {
+        count_++;
+      }
+      return record;
+    }
+
+    TraceRecord *TraceBuffer::last() {
+      if (count_ == 0) {
+        return nullptr;
+      }
+      return &records_[(next_ + records_.size() - 1) % records_.size()];
+    }
+
+    void TraceBuffer::dump(const char *tag) {
+      ESP_LOGI(tag, "Trace: %u records", (unsigned) count_);
+      size_t first = (next_ + records_.size() - count_) % records_.size();
+      for (size_t i = 0; i < count_; ++i) {
+        const TraceRecord &record = records_[(first + i) % records_.size()];
+
+        char commands[TRACE_COMMANDS * 5 + 1] = "";
+        size_t kept = record.command_count < TRACE_COMMANDS ? record.command_count : TRACE_COMMANDS;
+        size_t pos = 0;
+        for (size_t j = 0; j < kept; ++j) {
+          pos += snprintf(commands + pos, sizeof(commands) - pos, "%s%04X", j > 0 ? " " : "", record.commands[j]);
+        }
+
+        ESP_LOGI(tag, "trace,%" PRIu32 ",%u,%u,%u,%u,%s", record.time, record.mireds, record.brightness,
+                 record.applied, record.command_count, commands);
+      }
+    }
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+  namespace ir_light_base {
+    // One light state handed to write_state(), and the commands planned for it
+    struct TraceRecord {
+      uint32_t time;
+      // Raw color temperature in mireds
+      uint16_t mireds;
+      // Gamma corrected brightness, scaled to 0-65535
+      uint16_t brightness;
+      // Whether the state was planned, rather than replaced by a newer one
+      // first
+      bool applied;
+      // Number of commands planned, of which up to TRACE_COMMANDS are kept
+      uint8_t command_count;
+      uint16_t commands[6];
+    };
+
+    static const size_t TRACE_COMMANDS = sizeof(TraceRecord::commands) / sizeof(TraceRecord::commands[0]);
+
+    // Fixed size ring buffer of the most recent records, allocated once
+    class TraceBuffer {
+    public:
+      void set_size(size_t size) { records_.resize(size); }
+      bool enabled() const { return !records_.empty(); }
+
+      // Start a new record, overwriting the oldest one when full
+      TraceRecord *add();
+      // The most recently added record, nullptr if there is none
+      TraceRecord *last();
+
+      // Log every record, oldest first, one comma separated line each:
+      //   trace,<time ms>,<mireds>,<brightness>,<applied>,<command count>,<commands in hex>
+      void dump(const char *tag);
+
+    protected:
+      std::vector<TraceRecord> records_;
+      size_t next_{0};
+      size_t count_{0};
+    };
+  }
+}
@@ -1,27 +1,31 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 
-from esphome.components import light, remote_transmitter, remote_base
-from esphome.components.remote_base import CONF_TRANSMITTER_ID
+from esphome.components import ir_light_base
 from esphome.const import CONF_OUTPUT_ID, CONF_CHANNEL
 
 DEPENDENCIES = ["remote_base", "light"]
+AUTO_LOAD = ["ir_light_base"]
+
+CONF_HOLD_REPEATS = 'hold_repeats'
 
 nec_light_ns = cg.esphome_ns.namespace('nec_light')
-NecLightOutput = nec_light_ns.class_('NecLightOutput', cg.Component, light.LightOutput)
+NecLightOutput = nec_light_ns.class_('NecLightOutput', ir_light_base.IrLightOutputBase)
 
-CONFIG_SCHEMA = light.RGB_LIGHT_SCHEMA.extend({
+CONFIG_SCHEMA = ir_light_base.IR_LIGHT_SCHEMA.extend({
     cv.GenerateID(CONF_OUTPUT_ID): cv.declare_id(NecLightOutput),
-    cv.GenerateID(CONF_TRANSMITTER_ID): cv.use_id(remote_transmitter.RemoteTransmitterComponent),
-    cv.Optional(CONF_CHANNEL, default=1): cv.int_range(min=1, max=2)
-  }).extend(cv.COMPONENT_SCHEMA)
+    cv.Optional(CONF_CHANNEL, default=1): cv.int_range(min=1, max=2),
+    # Repeat codes the fixture takes as one more step of a held button. When
+    # unset, every step is sent as a full frame, and buttons held on the
+    # remote are tracked as a single step.
+    cv.Optional(CONF_HOLD_REPEATS): cv.int_range(min=1, max=255),
+  })
+
+FINAL_VALIDATE_SCHEMA = ir_light_base.final_validate_ir_light
 
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_OUTPUT_ID])
-    await cg.register_component(var, config)
-
-    transmitter = await cg.get_variable(config[CONF_TRANSMITTER_ID])
-    cg.add(var.set_transmitter(transmitter))
+    await ir_light_base.register_ir_light(var, config)
     cg.add(var.set_channel(config[CONF_CHANNEL]))
-
-    await light.register_light(var, config)
+    if CONF_HOLD_REPEATS in config:
+        cg.add(var.set_hold_repeats(config[CONF_HOLD_REPEATS]))
@@ -1,13 +1,21 @@
 #include "esphome/core/log.h"
 #include "nec_light.h"
 
-#include "esphome/components/remote_base/nec_protocol.h"
+#include <algorithm>
+
+#include "esphome/components/ir_light_base/progmem_table.h"
+#include "esphome/components/ir_light_base/quantize.h"
 
 namespace esphome {
   namespace nec_light {
-    static const char *TAG = "nec_light";
+    using ir_light_base::IrCommand;
+    using ir_light_base::table_read;
+
+    const char *const NecProfile::TAG = "nec_light";
+    const char *const NecProfile::NAME = "Nec IR Ceiling Light";
 
-    static const uint16_t ADDR = 0x6d82;
+    static const char *const TAG = NecProfile::TAG;
+    static const uint16_t ADDR = NecProfile::ADDRESS;
 
     static const uint16_t CMD_ON  = 0x42bd;
     static const uint16_t CMD_OFF = 0x41be;
@@ -25,19 +33,81 @@ namespace esphome {
     static const uint16_t CMD_WARMER   = 0x57a8;
     static const uint16_t CMD_COOLER   = 0x58a7;
 
-    static const int COMMAND_DELAY = 255;
+    constexpr static const uint16_t COMMANDS[] PROGMEM = {
+      CMD_ON, CMD_OFF,
+      CMD_MAX_WARM, CMD_MAX_WHITE, CMD_MID_WHITE, CMD_MAX_COOL,
+      CMD_BRIGHTER, CMD_DIMMER, CMD_DIMMEST,
+      CMD_WARMER, CMD_COOLER
+    };
 
-    light::LightTraits NecLightOutput::get_traits() {
-      auto traits = light::LightTraits();
-      traits.set_supported_color_modes({light::ColorMode::COLOR_TEMPERATURE});
+    // Channel 2 lights use the same codes with two bits flipped
+    constexpr uint16_t channel_2_command(uint16_t command) {
+      return (command | 0x8000) & ~0x0080;
+    }
 
-      traits.set_min_mireds(154);
-      traits.set_max_mireds(370);
+    constexpr static const auto CHANNEL_1_FRAMES PROGMEM = ir_light_base::make_nec_frame_table(ADDR, COMMANDS);
+    constexpr static const auto CHANNEL_2_FRAMES PROGMEM =
+        ir_light_base::make_nec_frame_table(ADDR, COMMANDS, channel_2_command);
+    const size_t NecProfile::FRAME_TABLE_BYTES = sizeof(CHANNEL_1_FRAMES) + sizeof(CHANNEL_2_FRAMES);
+
+    // The planner works over the 5x10 grid of (color, brightness) levels the
+    // light can be in while on, with states numbered color * 10 + brightness.
+    static const int NUM_COLOR_LEVELS = 5;
+    static const int NUM_BRIGHTNESS_LEVELS = 10;
+    static const int NUM_STATES = NUM_COLOR_LEVELS * NUM_BRIGHTNESS_LEVELS;
+
+    // Commands that move relative to the current state, and so are only
+    // accepted while the light is on. Steps saturate at the ends of each
+    // range. CMD_DIMMEST drops to the lowest brightness, keeping the color.
+    // Like the other tables here, kept in flash on ESP8266.
+    static const uint16_t RELATIVE_COMMANDS[] PROGMEM = { CMD_WARMER, CMD_COOLER, CMD_BRIGHTER, CMD_DIMMER, CMD_DIMMEST };
+    static const int NUM_RELATIVE_COMMANDS = sizeof(RELATIVE_COMMANDS) / sizeof(RELATIVE_COMMANDS[0]);
+
+    constexpr uint8_t relative_step(int command_index, int state) {
+      int color = state / NUM_BRIGHTNESS_LEVELS;
+      int brightness = state % NUM_BRIGHTNESS_LEVELS;
+      switch (command_index) {
+      case 0: color = std::min(color + 1, NUM_COLOR_LEVELS - 1); break;
+      case 1: color = std::max(color - 1, 0); break;
+      case 2: brightness = std::min(brightness + 1, NUM_BRIGHTNESS_LEVELS - 1); break;
+      case 3: brightness = std::max(brightness - 1, 0); break;
+      case 4: brightness = 0; break;
+      }
+      return color * NUM_BRIGHTNESS_LEVELS + brightness;
+    }
+
+    struct step_table {
+      uint8_t next[NUM_RELATIVE_COMMANDS][NUM_STATES];
+    };
 
-      return traits;
+    constexpr step_table build_step_table() {
+      step_table table{};
+      for (int command = 0; command < NUM_RELATIVE_COMMANDS; ++command) {
+        for (int state = 0; state < NUM_STATES; ++state) {
+          table.next[command][state] = relative_step(command, state);
+        }
+      }
+      return table;
     }
 
-    void NecLightOutput::write_state(light::LightState *state) {
+    constexpr static const step_table STEP_TABLE PROGMEM = build_step_table();
+
+    // Absolute codes reach a fixed state in one frame from anywhere,
+    // including off or an unknown state
+    struct anchor {
+      uint16_t command;
+      uint8_t state;
+    };
+
+    constexpr static const anchor ANCHORS[] PROGMEM = {
+      { CMD_MAX_COOL,  CT_ACTIVE  * NUM_BRIGHTNESS_LEVELS + BRT_MAX },
+      { CMD_MAX_WHITE, CT_NATURAL * NUM_BRIGHTNESS_LEVELS + BRT_MAX },
+      { CMD_MID_WHITE, CT_NATURAL * NUM_BRIGHTNESS_LEVELS + BRT_MID },
+      { CMD_MAX_WARM,  CT_RELAX   * NUM_BRIGHTNESS_LEVELS + BRT_MAX },
+    };
+
+    NecState NecProfile::quantize(light::LightState *state, const NecState &previous,
+                                  const ir_light_base::QuantizeOptions &options) {
       light::LightColorValues current_values = state->current_values;
 
       // Read the raw color temperature, because we want to convert from mireds
@@ -48,123 +118,186 @@ namespace esphome {
       float brightness;
       state->current_values_as_brightness(&brightness);
 
-      ESP_LOGD(TAG, "Channel %u received state: brightness=%f, color_temperature=%f mireds",
-               channel_, brightness, ct_mireds);
+      IR_LIGHT_LOG_STATE(TAG, "Received state: brightness=%f, color_temperature=%f mireds",
+               brightness, ct_mireds);
 
+      NecState target;
       if (brightness == 0.0f) {
-        ESP_LOGD(TAG, "Turning off");
-        send_command_(CMD_OFF);
-        current_on_ = false;
-        return;
+        target.power = ir_light_base::POWER_OFF;
+        return target;
       }
 
-      NecLightOutput::brightness_level brightness_level = select_brightness_level_(brightness);
-      NecLightOutput::color_level color_level = select_color_level_(ct_mireds);
+      target.power = ir_light_base::POWER_ON;
+      target.brightness = select_brightness_level(brightness, previous.brightness, options);
+      target.color = select_color_level(ct_mireds, previous.color, options.color_hysteresis);
 
-      ESP_LOGD(TAG, "Selected levels: brightness=%d, color_temperature=%d",
-               brightness_level, color_level);
+      IR_LIGHT_LOG_STATE(TAG, "Selected levels: brightness=%d, color_temperature=%d",
+               target.brightness, target.color);
+      return target;
+    }
 
-      // If we match a state with an absolute code, send it
-      if (brightness_level == BRT_MAX && color_level == CT_ACTIVE) {
-        ESP_LOGD(TAG, "Absolute setting: max cool");
-        send_command_(CMD_MAX_COOL);
-      }
-      else if (brightness_level == BRT_MAX && color_level == CT_NATURAL) {
-        ESP_LOGD(TAG, "Absolute setting: max white");
-        send_command_(CMD_MAX_WHITE);
-      }
-      else if (brightness_level == BRT_MID && color_level == CT_NATURAL) {
-        ESP_LOGD(TAG, "Absolute setting: mid white");
-        send_command_(CMD_MID_WHITE);
+    void NecProfile::plan(const NecState &from, const NecState &to, std::vector<IrCommand> *commands) {
+      if (to.power == ir_light_base::POWER_OFF) {
+        if (from.power != ir_light_base::POWER_OFF) {
+          commands->push_back({CMD_OFF, 0});
+        }
+        return;
       }
-      else if (brightness_level == BRT_MAX && color_level == CT_RELAX) {
-        ESP_LOGD(TAG, "Absolute setting: max warm");
-        send_command_(CMD_MAX_WARM);
+
+      // Breadth-first search for the shortest command sequence. Every state
+      // records the command that first reached it and the state it came from.
+      static const uint8_t NONE = 0xff;
+      uint8_t dist[NUM_STATES];
+      uint8_t prev_state[NUM_STATES];
+      uint16_t prev_command[NUM_STATES];
+      uint8_t queue[NUM_STATES];
+      int head = 0, tail = 0;
+
+      std::fill(std::begin(dist), std::end(dist), NONE);
+
+      if (from.known()) {
+        uint8_t current = from.color * NUM_BRIGHTNESS_LEVELS + from.brightness;
+        dist[current] = from.power == ir_light_base::POWER_ON ? 0 : 1;
+        prev_state[current] = NONE;
+        prev_command[current] = CMD_ON;
+        queue[tail++] = current;
       }
-      // Otherwise, we need to send a relative change
-      else {
-        if (current_brightness_level_ == BRT_UNKNOWN || current_color_level_ == CT_UNKNOWN) {
-          ESP_LOGD(TAG, "Current state unknown, resetting to mid white");
-          send_command_(CMD_MID_WHITE);
 
-          current_brightness_level_ = BRT_MID;
-          current_color_level_ = CT_NATURAL;
+      for (const auto &anchor : ANCHORS) {
+        uint8_t state = table_read(&anchor.state);
+        if (dist[state] == NONE) {
+          dist[state] = 1;
+          prev_state[state] = NONE;
+          prev_command[state] = table_read(&anchor.command);
+          queue[tail++] = state;
+        }
+      }
 
-          delay(COMMAND_DELAY);
+      while (head < tail) {
+        uint8_t state = queue[head++];
+        for (int i = 0; i < NUM_RELATIVE_COMMANDS; ++i) {
+          uint8_t next = table_read(&STEP_TABLE.next[i][state]);
+          if (dist[next] == NONE) {
+            dist[next] = dist[state] + 1;
+            prev_state[next] = state;
+            prev_command[next] = table_read(&RELATIVE_COMMANDS[i]);
+            queue[tail++] = next;
+          }
         }
-        else if (!current_on_) {
-          ESP_LOGD(TAG, "Turning on");
-          send_command_(CMD_ON);
-          delay(COMMAND_DELAY);
+      }
+
+      // Walk back from the target, then reverse into sending order
+      size_t start = commands->size();
+      uint8_t state = to.color * NUM_BRIGHTNESS_LEVELS + to.brightness;
+      while (dist[state] != 0) {
+        commands->push_back({prev_command[state], 0});
+        if (prev_state[state] == NONE) {
+          break;
         }
+        state = prev_state[state];
+      }
+      std::reverse(commands->begin() + start, commands->end());
 
-        int color_delta = color_level - current_color_level_;
-        int brightness_delta = brightness_level - current_brightness_level_;
+      // Color and brightness steps commute, so do all color steps first. This
+      // keeps runs of the same command together for hold mode.
+      std::stable_partition(commands->begin() + start, commands->end(), [](const IrCommand &command) {
+        return command.command != CMD_BRIGHTER && command.command != CMD_DIMMER && command.command != CMD_DIMMEST;
+      });
+    }
 
-        ESP_LOGD(TAG, "Color %d -> %d: %d steps",
-                 current_color_level_, color_level, color_delta);
+    void NecProfile::apply(NecState *state, uint16_t command) {
+      if (command == CMD_OFF) {
+        state->power = ir_light_base::POWER_OFF;
+        return;
+      }
+      if (command == CMD_ON) {
+        state->power = ir_light_base::POWER_ON;
+        return;
+      }
 
-        if (color_delta != 0) {
-          uint16_t color_command = color_delta > 0 ? CMD_WARMER : CMD_COOLER;
-          for (int i = 0; i < abs(color_delta); ++i) {
-            send_command_(color_command);
-            delay(COMMAND_DELAY);
-          }
+      for (const auto &anchor : ANCHORS) {
+        if (command == table_read(&anchor.command)) {
+          uint8_t reached = table_read(&anchor.state);
+          state->power = ir_light_base::POWER_ON;
+          state->color = (color_level) (reached / NUM_BRIGHTNESS_LEVELS);
+          state->brightness = (brightness_level) (reached % NUM_BRIGHTNESS_LEVELS);
+          return;
         }
+      }
 
-        ESP_LOGD(TAG, "Brightness %d -> %d: %d steps",
-                 current_brightness_level_, brightness_level, brightness_delta);
+      if (!state->known()) {
+        return;
+      }
 
-        if (brightness_delta != 0) {
-          uint16_t brightness_command = brightness_delta > 0 ? CMD_BRIGHTER : CMD_DIMMER;
-          for (int i = 0; i < abs(brightness_delta); ++i) {
-            send_command_(brightness_command);
-            delay(COMMAND_DELAY);
-          }
+      uint8_t current = state->color * NUM_BRIGHTNESS_LEVELS + state->brightness;
+      for (int i = 0; i < NUM_RELATIVE_COMMANDS; ++i) {
+        if (command == table_read(&RELATIVE_COMMANDS[i])) {
+          uint8_t next = table_read(&STEP_TABLE.next[i][current]);
+          state->color = (color_level) (next / NUM_BRIGHTNESS_LEVELS);
+          state->brightness = (brightness_level) (next % NUM_BRIGHTNESS_LEVELS);
+          return;
         }
       }
-      current_on_ = true;
-      current_brightness_level_ = brightness_level;
-      current_color_level_ = color_level;
     }
 
-    void NecLightOutput::dump_config() {
-      ESP_LOGCONFIG(TAG, "Nec IR Ceiling Light");
+    const ir_light_base::NecFrameTimings *NecProfile::frame(uint16_t command, uint8_t channel) {
+      return channel == 2 ? CHANNEL_2_FRAMES.find(command) : CHANNEL_1_FRAMES.find(command);
     }
 
-    // Interpolating points between the color levels in Kelvin
-    // (since HA's CT selectors are linear in Kelvin):
-    // (6500) 6250 (6000) 5750 (5500) 4800 (4100) 3400 (2700) K
-    // (154)  160  (167)  174  (182)  208  (244)  294  (370) mired
-    static const float CT_THRESHOLDS[] = { 160, 174, 208, 294 };
-
-    NecLightOutput::color_level NecLightOutput::select_color_level_(float mired_val) {
-      for(int i = 0; i < (sizeof(CT_THRESHOLDS) / sizeof(CT_THRESHOLDS[0])); ++i) {
-        if (mired_val < CT_THRESHOLDS[i]) {
-          return (color_level) i;
+    bool NecProfile::decode(uint16_t code, uint8_t channel, uint16_t *command) {
+      for (const uint16_t &entry : COMMANDS) {
+        uint16_t candidate = table_read(&entry);
+        if (code == (channel == 2 ? channel_2_command(candidate) : candidate)) {
+          *command = candidate;
+          return true;
         }
       }
-      return CT_RELAX;
+      return false;
     }
 
-    NecLightOutput::brightness_level NecLightOutput::select_brightness_level_(float brightness_val) {
-      brightness_level brightness = (brightness_level) (brightness_val * 10.0);
-      return std::min(brightness, BRT_MAX);
+    // The documented color temperature of each level
+    static const float LEVEL_MIREDS[] PROGMEM = { 154, 167, 182, 244, 370 };
+
+    void NecProfile::describe(const NecState &state, const ir_light_base::QuantizeOptions &options, float *brightness,
+                              float *mireds) {
+      if (state.power == ir_light_base::POWER_OFF) {
+        *brightness = 0.0f;
+        return;
+      }
+      *brightness = ir_light_base::uniform_value(state.brightness, NUM_BRIGHTNESS_LEVELS, options.round_brightness);
+      *mireds = table_read(&LEVEL_MIREDS[state.color]);
     }
 
-    void NecLightOutput::send_command_(uint16_t command) {
-      if (channel_ == 2) {
-        command |= 0x8000;
-        command &= ~0x0080;
+    ir_light_base::command_type NecProfile::command_type_of(uint16_t command) {
+      if (command == CMD_ON || command == CMD_OFF) {
+        return ir_light_base::COMMAND_POWER;
+      }
+      for (const auto &anchor : ANCHORS) {
+        if (command == table_read(&anchor.command)) {
+          return ir_light_base::COMMAND_ABSOLUTE;
+        }
       }
-      send_nec_(ADDR, command);
+      return ir_light_base::COMMAND_RELATIVE;
+    }
+
+    bool NecProfile::holdable(uint16_t command) {
+      return command == CMD_BRIGHTER || command == CMD_DIMMER || command == CMD_WARMER || command == CMD_COOLER;
+    }
+
+    // Interpolating points between the color levels in Kelvin
+    // (since HA's CT selectors are linear in Kelvin):
+    // (6500) 6250 (6000) 5750 (5500) 4800 (4100) 3400 (2700) K
+    // (154)  160  (167)  174  (182)  208  (244)  294  (370) mired
+    static const float CT_THRESHOLDS[] PROGMEM = { 160, 174, 208, 294 };
+
+    color_level NecProfile::select_color_level(float mired_val, color_level previous, float hysteresis) {
+      return (color_level) ir_light_base::threshold_index(mired_val, CT_THRESHOLDS, false, previous, hysteresis);
     }
 
-    void NecLightOutput::send_nec_(uint16_t address, uint16_t command) {
-      auto transmit = this->emitter_->transmit();
-      remote_base::NECData data{address, command, 1};
-      remote_base::NECProtocol().encode(transmit.get_data(), data);
-      transmit.perform();
+    brightness_level NecProfile::select_brightness_level(float brightness_val, brightness_level previous,
+                                                         const ir_light_base::QuantizeOptions &options) {
+      return (brightness_level) ir_light_base::uniform_level(brightness_val, NUM_BRIGHTNESS_LEVELS, options.round_brightness,
+                                                             previous, options.brightness_hysteresis);
     }
   }
 }
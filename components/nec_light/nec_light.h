@@ -1,54 +1,71 @@
 #pragma once
 
-#include "esphome/core/component.h"
-#include "esphome/components/light/light_output.h"
-#include "esphome/components/remote_transmitter/remote_transmitter.h"
+#include <vector>
+
+#include "esphome/components/ir_light_base/ir_light_output.h"
 
 namespace esphome {
   namespace nec_light {
-    class NecLightOutput : public light::LightOutput, public Component {
-    public:
-      light::LightTraits get_traits() override;
-      void write_state(light::LightState *state) override;
-      void dump_config() override;
-      void set_transmitter(remote_transmitter::RemoteTransmitterComponent *emitter) { emitter_ = emitter; }
-      void set_channel(uint8_t channel) { channel_ = channel; }
-
-    private:
-      // Light has 5 selectable color temperatures:
-      // CT (k)  CT (m)    name
-      // 2700K - 370 mired ("relax")
-      // 4100K - 244 mired ("unwind")
-      // 5500K - 182 mired ("natural")
-      // 6000K - 167 mired ("refresh")
-      // 6500K - 154 mired ("active")
-      enum color_level {
-        CT_UNKNOWN = -1,
-        CT_ACTIVE = 0,
-        CT_REFRESH,
-        CT_NATURAL,
-        CT_UNWIND,
-        CT_RELAX
-      };
-
-      // Light has 10 selectable brightness levels
-      enum brightness_level {
-        BRT_UNKNOWN = -1,
-        BRT_MIN = 0,
-        BRT_MID = 5,
-        BRT_MAX = 9
-      };
-
-      color_level select_color_level_(float mired_val);
-      brightness_level select_brightness_level_(float brightness_val);
-      void send_command_(uint16_t command);
-      void send_nec_(uint16_t address, uint16_t command);
-
-      esphome::remote_transmitter::RemoteTransmitterComponent *emitter_{nullptr};
-      uint8_t channel_ { 1 };
-      bool current_on_ { false };
-      color_level current_color_level_{ CT_UNKNOWN };
-      brightness_level current_brightness_level_{ BRT_UNKNOWN };
+    // Light has 5 selectable color temperatures:
+    // CT (k)  CT (m)    name
+    // 2700K - 370 mired ("relax")
+    // 4100K - 244 mired ("unwind")
+    // 5500K - 182 mired ("natural")
+    // 6000K - 167 mired ("refresh")
+    // 6500K - 154 mired ("active")
+    enum color_level {
+      CT_UNKNOWN = -1,
+      CT_ACTIVE = 0,
+      CT_REFRESH,
+      CT_NATURAL,
+      CT_UNWIND,
+      CT_RELAX
+    };
+
+    // Light has 10 selectable brightness levels
+    enum brightness_level {
+      BRT_UNKNOWN = -1,
+      BRT_MIN = 0,
+      BRT_MID = 5,
+      BRT_MAX = 9
+    };
+
+    struct NecState {
+      ir_light_base::power_state power { ir_light_base::POWER_UNKNOWN };
+      color_level color { CT_UNKNOWN };
+      brightness_level brightness { BRT_UNKNOWN };
+
+      bool known() const { return color != CT_UNKNOWN && brightness != BRT_UNKNOWN; }
     };
+
+    struct NecProfile {
+      using State = NecState;
+
+      static const char *const TAG;
+      static const char *const NAME;
+      static const size_t FRAME_TABLE_BYTES;
+      static const uint16_t ADDRESS = 0x6d82;
+      static constexpr float MIN_MIREDS = 154;
+      static constexpr float MAX_MIREDS = 370;
+      static const uint16_t COMMAND_GAP = 255;
+
+      static State quantize(light::LightState *state, const State &previous, const ir_light_base::QuantizeOptions &options);
+      static void plan(const State &from, const State &to, std::vector<ir_light_base::IrCommand> *commands);
+      static void apply(State *state, uint16_t command);
+      static const ir_light_base::NecFrameTimings *frame(uint16_t command, uint8_t channel);
+      static bool decode(uint16_t code, uint8_t channel, uint16_t *command);
+      static void describe(const State &state, const ir_light_base::QuantizeOptions &options, float *brightness,
+                           float *mireds);
+      // The light keeps its levels while off
+      static State off(const State &state) { return State{ir_light_base::POWER_OFF, state.color, state.brightness}; }
+      static ir_light_base::command_type command_type_of(uint16_t command);
+      static bool holdable(uint16_t command);
+
+      static color_level select_color_level(float mired_val, color_level previous, float hysteresis);
+      static brightness_level select_brightness_level(float brightness_val, brightness_level previous,
+                                                      const ir_light_base::QuantizeOptions &options);
+    };
+
+    using NecLightOutput = ir_light_base::IrLightOutput<NecProfile>;
   }
 }
@@ -1,14 +1,19 @@
 #include "esphome/core/log.h"
 #include "photo_light.h"
 
-#include "esphome/components/remote_base/nec_protocol.h"
-#include "esphome/components/remote_base/pronto_protocol.h"
+#include "esphome/components/ir_light_base/progmem_table.h"
+#include "esphome/components/ir_light_base/quantize.h"
 
 namespace esphome {
   namespace photo_light {
-    static const char *TAG = "photo_light";
+    using ir_light_base::IrCommand;
+    using ir_light_base::table_read;
 
-    static const uint16_t ADDR = 0xfe01;
+    const char *const PhotoProfile::TAG = "photo_light";
+    const char *const PhotoProfile::NAME = "Photographic Light Box Bulb";
+
+    static const char *const TAG = PhotoProfile::TAG;
+    static const uint16_t ADDR = PhotoProfile::ADDRESS;
 
     static const uint16_t TOGGLE = 0xff00;
 
@@ -24,127 +29,216 @@ namespace esphome {
     static const uint16_t CT_WARMER = 0xf50a;
     static const uint16_t CT_COOLER = 0xfd02;
 
+    constexpr static const uint16_t COMMANDS[] PROGMEM = {
+      TOGGLE,
+      BRT_100, BRT_50, BRT_20, BRT_SLEEP,
+      CT_COLD, CT_WHITE, CT_WARM,
+      CT_WARMER, CT_COOLER
+    };
+
+    constexpr static const auto FRAMES PROGMEM = ir_light_base::make_nec_frame_table(ADDR, COMMANDS);
+    const size_t PhotoProfile::FRAME_TABLE_BYTES = sizeof(FRAMES);
+
+    // Number of repeat codes sent after a color adjustment
+    static const uint8_t ADJUSTMENT_REPEATS = 8;
+
+    // Each setting applies if the current value is at most its threshold.
+    // These and the settings tables are kept in flash on ESP8266.
+    constexpr static const float COLOR_THRESHOLDS[] PROGMEM = { 0.08, 0.25, 0.42, 0.59, 0.76, 0.93 };
+    constexpr static const float BRIGHTNESS_THRESHOLDS[] PROGMEM = { 0.2, 0.5, 0.8 };
+
     struct color_setting {
-      // applies if the current color state is less than the threshold
-      float threshold;
       uint16_t base;
       uint16_t adjustment;
-      const char* name;
     };
 
-    constexpr static const color_setting color_settings[] = {
-      { 0.08, CT_COLD,  0,         "Cold"   },
-      { 0.25, CT_COLD,  CT_WARMER, "Cold+"  },
-      { 0.42, CT_WHITE, CT_COOLER, "White-" },
-      { 0.59, CT_WHITE, 0,         "White"  },
-      { 0.76, CT_WHITE, CT_WARMER, "White+" },
-      { 0.93, CT_WARM,  CT_COOLER, "Warm-"  },
-      { 1.00, CT_WARM,  0,         "Warm"   }
+    constexpr static const color_setting color_settings[] PROGMEM = {
+      { CT_COLD,  0         },
+      { CT_COLD,  CT_WARMER },
+      { CT_WHITE, CT_COOLER },
+      { CT_WHITE, 0         },
+      { CT_WHITE, CT_WARMER },
+      { CT_WARM,  CT_COOLER },
+      { CT_WARM,  0         }
     };
 
     struct brightness_setting {
-      float threshold;
       uint16_t setting;
-      const char* name;
     };
 
-    constexpr static const brightness_setting brightness_settings[] = {
-      { 0.2, 0,         "Off" },
-      { 0.5, BRT_SLEEP, "Sleep" },
-      { 0.8, BRT_50,    "50%" },
-      { 1.0, BRT_100,   "100%" }
+    constexpr static const brightness_setting brightness_settings[] PROGMEM = {
+      { 0         },
+      { BRT_SLEEP },
+      { BRT_50    },
+      { BRT_100   }
     };
 
-    light::LightTraits PhotoLightOutput::get_traits() {
-      auto traits = light::LightTraits();
-      traits.set_supported_color_modes({ light::ColorMode::COLOR_TEMPERATURE });
+    static const int NUM_COLOR_SETTINGS = sizeof(color_settings) / sizeof(color_settings[0]);
+    static const int NUM_BRIGHTNESS_SETTINGS = sizeof(brightness_settings) / sizeof(brightness_settings[0]);
 
-      // 70 mired is a blatant lie, but the goal here is to make the "white" color
-      // line up with the documented-as-5500K (182 mired) white color of the NEC
-      // lights, which results in wildly stretching out the cold side.
-      traits.set_min_mireds(50);
-      traits.set_max_mireds(370);
-      return traits;
+    static color_setting read_color_setting(int index) {
+      return { table_read(&color_settings[index].base), table_read(&color_settings[index].adjustment) };
     }
 
-    void PhotoLightOutput::write_state(light::LightState *state) {
-      float color_temperature_val, brightness_val;
-      brightness_setting brightness = brightness_settings[0];
-      color_setting color = color_settings[0];
+    static brightness_setting read_brightness_setting(int index) {
+      return { table_read(&brightness_settings[index].setting) };
+    }
+
+    // Only referenced by logging, so they're left out of the build along
+    // with it
+    static const char *const COLOR_NAMES[] = { "Cold", "Cold+", "White-", "White", "White+", "Warm-", "Warm" };
+    static const char *const BRIGHTNESS_NAMES[] = { "Off", "Sleep", "50%", "100%" };
 
+    static const int BRT_INDEX_OFF = 0;
+    static const int BRT_INDEX_100 = 3;
+
+    PhotoState PhotoProfile::quantize(light::LightState *state, const PhotoState &previous,
+                                      const ir_light_base::QuantizeOptions &options) {
+      float color_temperature_val, brightness_val;
       state->current_values_as_ct(&color_temperature_val, &brightness_val);
 
-      ESP_LOGD("photo_light", "Received state: brightness=%f, color_temperature=%f",
+      IR_LIGHT_LOG_STATE(TAG, "Received state: brightness=%f, color_temperature=%f",
                brightness_val, color_temperature_val);
 
-      for(int i = 0; i < (sizeof(color_settings) / sizeof(color_settings[0])); ++i) {
-        if (color_temperature_val <= color_settings[i].threshold) {
-          color = color_settings[i];
-          break;
+      PhotoState target;
+      // Color temperature is read as a fraction of the mired range
+      float color_hysteresis = options.color_hysteresis / (MAX_MIREDS - MIN_MIREDS);
+      target.color = ir_light_base::threshold_index(color_temperature_val, COLOR_THRESHOLDS, true,
+                                                    previous.color, color_hysteresis);
+      target.brightness = ir_light_base::threshold_index(brightness_val, BRIGHTNESS_THRESHOLDS, true,
+                                                         previous.brightness, options.brightness_hysteresis);
+
+      IR_LIGHT_LOG_STATE(TAG, "Selected settings: brightness=%s, color=%s",
+                         BRIGHTNESS_NAMES[target.brightness], COLOR_NAMES[target.color]);
+      return target;
+    }
+
+    void PhotoProfile::plan(const PhotoState &from, const PhotoState &to, std::vector<IrCommand> *commands) {
+      brightness_setting brightness = read_brightness_setting(to.brightness);
+      color_setting color = read_color_setting(to.color);
+
+      bool was_on = from.brightness > 0 && from.color >= 0;
+
+      if (!brightness.setting) {
+        if (from.brightness == BRT_INDEX_OFF) {
+          return;
         }
+
+        // Off is handled specially
+        commands->push_back({BRT_SLEEP, 0});
+        commands->push_back({TOGGLE, 0});
       }
+      else if (was_on && to.color == from.color) {
+        if (to.brightness == from.brightness) {
+          return;
+        }
 
-      for(int i = 0; i < (sizeof(brightness_settings) / sizeof(brightness_settings[0])); ++i) {
-        if (brightness_val <= brightness_settings[i].threshold) {
-          brightness = brightness_settings[i];
-          break;
+        // Brightness commands leave the color alone
+        commands->push_back({brightness.setting, 0});
+      }
+      else if (was_on && color.adjustment && read_color_setting(from.color).base == color.base &&
+               !read_color_setting(from.color).adjustment) {
+        // Already at the unadjusted base color, so only the refinement is needed
+        if (to.brightness != from.brightness) {
+          commands->push_back({brightness.setting, 0});
         }
+        commands->push_back({color.adjustment, ADJUSTMENT_REPEATS});
       }
+      else {
+        // Set color temperature first, because the base color commands force 100% brightness
+        commands->push_back({color.base, 0});
 
-      ESP_LOGD("photo_light", "Selected settings: brightness=%s, color=%s",
-               brightness.name, color.name);
+        // Now set brightness, unless that's the 100% the base color left it at
+        if (brightness.setting != BRT_100) {
+          commands->push_back({brightness.setting, 0});
+        }
 
-      // Set color temperature first, because the base color commands force 100% brightness
-      if (brightness.setting) {
-        this->send_nec_(ADDR, color.base);
-        // brief delay: don't know if this is necessary
-        delay(25);
+        // Set refined color temperature where necessary
+        if (color.adjustment) {
+          commands->push_back({color.adjustment, ADJUSTMENT_REPEATS});
+        }
       }
+    }
 
-      // Now set brightness
-      if (brightness.setting) {
-        this->send_nec_(ADDR, brightness.setting);
+    void PhotoProfile::apply(PhotoState *state, uint16_t command) {
+      if (command == TOGGLE) {
+        // Toggling on from off comes back at whatever the light remembered
+        state->brightness = state->brightness > 0 ? BRT_INDEX_OFF : -1;
+        return;
       }
-      else {
-        // Off is handled specially
-        ESP_LOGD("photo_light", "brightness: off");
-        this->send_nec_(ADDR, BRT_SLEEP);
-        delay(25);
-        this->send_nec_(ADDR, TOGGLE);
+
+      for (int i = 0; i < NUM_BRIGHTNESS_SETTINGS; ++i) {
+        uint16_t setting = read_brightness_setting(i).setting;
+        if (setting && command == setting) {
+          state->brightness = i;
+          return;
+        }
       }
 
-      // Set refined color temperature where necessary
-      if (brightness.setting && color.adjustment) {
-        delay(25); // again, don't know if the delay is necessary
-        this->send_nec_(ADDR, color.adjustment);
-        this->send_repeat_(8);
+      for (int i = 0; i < NUM_COLOR_SETTINGS; ++i) {
+        color_setting setting = read_color_setting(i);
+        if (!setting.adjustment && command == setting.base) {
+          // Base colors also reset brightness to 100%
+          state->color = i;
+          state->brightness = BRT_INDEX_100;
+          return;
+        }
       }
 
-      this->last_brightness_  = brightness_val;
-      this->last_color_temperature_ = color_temperature_val;
+      if (command == CT_WARMER || command == CT_COOLER) {
+        // Adjustments only work while on
+        if (state->brightness == BRT_INDEX_OFF) {
+          return;
+        }
+        int color = -1;
+        if (state->color >= 0 && state->brightness > 0) {
+          // The tint steps from where it is: back to the plain base color
+          // from the other adjustment, and no further than one adjustment
+          color_setting current = read_color_setting(state->color);
+          uint16_t adjustment = current.adjustment == 0 ? command : current.adjustment == command ? command : 0;
+          for (int i = 0; i < NUM_COLOR_SETTINGS; ++i) {
+            color_setting setting = read_color_setting(i);
+            if (setting.base == current.base && setting.adjustment == adjustment) {
+              color = i;
+              break;
+            }
+          }
+        }
+        state->color = color;
+      }
     }
 
-    void PhotoLightOutput::dump_config() {
-      ESP_LOGCONFIG(TAG, "Photographic Light Box Bulb");
+    bool PhotoProfile::decode(uint16_t code, uint8_t channel, uint16_t *command) {
+      if (FRAMES.find(code) == nullptr) {
+        return false;
+      }
+      *command = code;
+      return true;
     }
 
-    void PhotoLightOutput::send_nec_(uint16_t address, uint16_t command) {
-      auto transmit = this->emitter_->transmit();
-      remote_base::NECData data{address, command};
-      remote_base::NECProtocol().encode(transmit.get_data(), data);
-      transmit.perform();
+    ir_light_base::command_type PhotoProfile::command_type_of(uint16_t command) {
+      if (command == TOGGLE) {
+        return ir_light_base::COMMAND_POWER;
+      }
+      if (command == CT_WARMER || command == CT_COOLER) {
+        return ir_light_base::COMMAND_RELATIVE;
+      }
+      return ir_light_base::COMMAND_ABSOLUTE;
     }
 
-    static const uint32_t repeat_send_wait = 50000; // 50ms
-    constexpr static const char* repeat_pronto_code = "0000 006D 0002 0000 0159 0057 0015 06C3";
+    // Values in the middle of each setting's range. The settings are fixed
+    // thresholds, so the quantize options don't move them.
+    static const float COLOR_VALUES[] PROGMEM = { 0.04, 0.165, 0.335, 0.505, 0.675, 0.845, 0.965 };
+    static const float BRIGHTNESS_VALUES[] PROGMEM = { 0.0, 0.35, 0.65, 1.0 };
+
+    void PhotoProfile::describe(const PhotoState &state, const ir_light_base::QuantizeOptions &options,
+                                float *brightness, float *mireds) {
+      *brightness = table_read(&BRIGHTNESS_VALUES[state.brightness]);
+      *mireds = MIN_MIREDS + table_read(&COLOR_VALUES[state.color]) * (MAX_MIREDS - MIN_MIREDS);
+    }
 
-    void PhotoLightOutput::send_repeat_(uint8_t times) {
-      auto transmit = this->emitter_->transmit();
-      remote_base::ProntoData data {repeat_pronto_code};
-      remote_base::ProntoProtocol().encode(transmit.get_data(), data);
-      transmit.set_send_times(times);
-      transmit.set_send_wait(repeat_send_wait);
-      transmit.perform();
+    const ir_light_base::NecFrameTimings *PhotoProfile::frame(uint16_t command, uint8_t channel) {
+      return FRAMES.find(command);
     }
   }
 }
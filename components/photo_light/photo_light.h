@@ -1,26 +1,48 @@
 #pragma once
 
-#include "esphome/core/component.h"
-#include "esphome/components/light/light_output.h"
-#include "esphome/components/remote_transmitter/remote_transmitter.h"
+#include <vector>
+
+#include "esphome/components/ir_light_base/ir_light_output.h"
 
 namespace esphome {
   namespace photo_light {
-    class PhotoLightOutput : public light::LightOutput, public Component {
-    public:
-      light::LightTraits get_traits() override;
-      void write_state(light::LightState *state) override;
-      void dump_config() override;
-      void set_transmitter(remote_transmitter::RemoteTransmitterComponent *emitter) { emitter_ = emitter; }
+    // Indices into the color and brightness settings the light is in, -1
+    // when unknown. Brightness index 0 is off.
+    struct PhotoState {
+      int color { -1 };
+      int brightness { -1 };
+
+      bool known() const { return color >= 0 && brightness >= 0; }
+    };
 
-    private:
+    struct PhotoProfile {
+      using State = PhotoState;
 
-      void send_nec_(uint16_t address, uint16_t command);
-      void send_repeat_(uint8_t times);
+      static const char *const TAG;
+      static const char *const NAME;
+      static const size_t FRAME_TABLE_BYTES;
+      static const uint16_t ADDRESS = 0xfe01;
+      // 70 mired is a blatant lie, but the goal here is to make the "white" color
+      // line up with the documented-as-5500K (182 mired) white color of the NEC
+      // lights, which results in wildly stretching out the cold side.
+      static constexpr float MIN_MIREDS = 50;
+      static constexpr float MAX_MIREDS = 370;
+      // brief gap between commands: don't know if this is necessary
+      static const uint16_t COMMAND_GAP = 25;
 
-      esphome::remote_transmitter::RemoteTransmitterComponent *emitter_{nullptr};
-      float last_color_temperature_ {0};
-      float last_brightness_ {0};
+      static State quantize(light::LightState *state, const State &previous, const ir_light_base::QuantizeOptions &options);
+      static void plan(const State &from, const State &to, std::vector<ir_light_base::IrCommand> *commands);
+      static void apply(State *state, uint16_t command);
+      static const ir_light_base::NecFrameTimings *frame(uint16_t command, uint8_t channel);
+      static bool decode(uint16_t code, uint8_t channel, uint16_t *command);
+      static void describe(const State &state, const ir_light_base::QuantizeOptions &options, float *brightness,
+                           float *mireds);
+      // Brightness index 0 is off, the color is kept
+      static State off(const State &state) { return State{state.color, 0}; }
+      static ir_light_base::command_type command_type_of(uint16_t command);
+      static bool holdable(uint16_t command) { return false; }
     };
+
+    using PhotoLightOutput = ir_light_base::IrLightOutput<PhotoProfile>;
   }
 }
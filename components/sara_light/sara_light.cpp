@@ -1,17 +1,27 @@
 #include "esphome/core/log.h"
 #include "sara_light.h"
 
-#include "esphome/components/remote_base/nec_protocol.h"
+#include <algorithm>
+#include <cstdlib>
+
+#include "esphome/components/ir_light_base/progmem_table.h"
+#include "esphome/components/ir_light_base/quantize.h"
 
 namespace esphome {
   namespace sara_light {
-      static const char *TAG = "sara_light";
+      using ir_light_base::IrCommand;
+      using ir_light_base::table_read;
+
+      const char *const SaraProfile::TAG = "sara_light";
+      const char *const SaraProfile::NAME = "Sara IR Ceiling Light";
 
-      static const uint16_t ADDR = 0xC580;
+      static const char *const TAG = SaraProfile::TAG;
+      static const uint16_t ADDR = SaraProfile::ADDRESS;
 
       static const uint16_t CMD_OFF = 0xF708;
 
-      constexpr static const uint16_t CMDS_WARM[] = {
+      // The tables are kept in flash on ESP8266
+      constexpr static const uint16_t CMDS_WARM[] PROGMEM = {
           0xA758,
           0xA55A,
           0xA35C,
@@ -24,7 +34,7 @@ namespace esphome {
           0x956A,
       };
 
-      constexpr static const uint16_t CMDS_COOL[] = {
+      constexpr static const uint16_t CMDS_COOL[] PROGMEM = {
           0x936C,
           0x916E,
           0x8F70,
@@ -59,19 +69,13 @@ namespace esphome {
       // static const uint16_t CMD_WARM_LVL_9  = 0x837C;
       // static const uint16_t CMD_WARM_LVL_10 = 0x817E;
 
-      static const int COMMAND_DELAY = 500;
-
-      light::LightTraits SaraLightOutput::get_traits() {
-          auto traits = light::LightTraits();
-          traits.set_supported_color_modes({light::ColorMode::COLOR_TEMPERATURE});
-
-          traits.set_min_mireds(154);
-          traits.set_max_mireds(370);
-
-          return traits;
-      }
+      constexpr static const auto OFF_FRAMES PROGMEM = ir_light_base::make_nec_frame_table(ADDR, {CMD_OFF});
+      constexpr static const auto WARM_FRAMES PROGMEM = ir_light_base::make_nec_frame_table(ADDR, CMDS_WARM);
+      constexpr static const auto COOL_FRAMES PROGMEM = ir_light_base::make_nec_frame_table(ADDR, CMDS_COOL);
+      const size_t SaraProfile::FRAME_TABLE_BYTES = sizeof(OFF_FRAMES) + sizeof(WARM_FRAMES) + sizeof(COOL_FRAMES);
 
-      void SaraLightOutput::write_state(light::LightState *state) {
+      SaraState SaraProfile::quantize(light::LightState *state, const SaraState &previous,
+                                      const ir_light_base::QuantizeOptions &options) {
           light::LightColorValues current_values = state->current_values;
 
           // Read the raw color temperature, because we want to convert from mireds
@@ -82,50 +86,163 @@ namespace esphome {
           float brightness;
           state->current_values_as_brightness(&brightness);
 
-          ESP_LOGD(TAG, "Light received state: brightness=%f, color_temperature=%f mireds",
+          IR_LIGHT_LOG_STATE(TAG, "Light received state: brightness=%f, color_temperature=%f mireds",
                    brightness, ct_mireds);
 
+          SaraState target;
           if (brightness == 0.0f) {
-              ESP_LOGD(TAG, "Turning off");
-              send_command_(CMD_OFF);
+              target.power = ir_light_base::POWER_OFF;
+              return target;
+          }
+
+          int previous_color = previous.known() ? color_level_of(previous.levels) : -1;
+          color_level color_level = select_color_level(ct_mireds, previous_color, options.color_hysteresis);
+          target.power = ir_light_base::POWER_ON;
+          target.levels = select_brightness_levels(brightness, color_level, previous.levels, options);
+
+          IR_LIGHT_LOG_STATE(TAG, "Selected levels: color=%d => warm brightness=%d cool brightness=%d",
+                   color_level, target.levels.warm, target.levels.cool);
+          return target;
+      }
+
+      void SaraProfile::plan(const SaraState &from, const SaraState &to, std::vector<IrCommand> *commands) {
+          if (to.power == ir_light_base::POWER_OFF) {
+              if (from.power != ir_light_base::POWER_OFF) {
+                  commands->push_back({CMD_OFF, 0});
+              }
+              return;
+          }
+
+          // Only send the channels that differ from what the light last
+          // received. Coming from off or an unknown state, send both.
+          bool on = from.power == ir_light_base::POWER_ON;
+          bool send_warm = !on || from.levels.warm != to.levels.warm;
+          bool send_cool = !on || from.levels.cool != to.levels.cool;
+
+          IrCommand warm_cmd{table_read(&CMDS_WARM[to.levels.warm]), 0};
+          IrCommand cool_cmd{table_read(&CMDS_COOL[to.levels.cool]), 0};
+
+          // Send the larger, more visible change first
+          if (send_cool && level_change(from.levels.cool, to.levels.cool) >
+                           level_change(from.levels.warm, to.levels.warm)) {
+              commands->push_back(cool_cmd);
+              send_cool = false;
+          }
+          if (send_warm) {
+              commands->push_back(warm_cmd);
+          }
+          if (send_cool) {
+              commands->push_back(cool_cmd);
+          }
+      }
+
+      void SaraProfile::apply(SaraState *state, uint16_t command) {
+          if (command == CMD_OFF) {
+              state->power = ir_light_base::POWER_OFF;
+              return;
+          }
+
+          for (int i = BRT_MIN; i <= BRT_MAX; ++i) {
+              if (command == table_read(&CMDS_WARM[i])) {
+                  state->power = ir_light_base::POWER_ON;
+                  state->levels.warm = (brightness_level) i;
+                  return;
+              }
+              if (command == table_read(&CMDS_COOL[i])) {
+                  state->power = ir_light_base::POWER_ON;
+                  state->levels.cool = (brightness_level) i;
+                  return;
+              }
+          }
+      }
+
+      const ir_light_base::NecFrameTimings *SaraProfile::frame(uint16_t command, uint8_t channel) {
+          if (command == CMD_OFF) {
+              return &OFF_FRAMES.frames[0];
+          }
+          const ir_light_base::NecFrameTimings *frame = WARM_FRAMES.find(command);
+          return frame != nullptr ? frame : COOL_FRAMES.find(command);
+      }
+
+      bool SaraProfile::decode(uint16_t code, uint8_t channel, uint16_t *command) {
+          if (code != CMD_OFF && WARM_FRAMES.find(code) == nullptr && COOL_FRAMES.find(code) == nullptr) {
+              return false;
           }
-          else {
-              SaraLightOutput::color_level color_level = select_color_level_(ct_mireds);
-              SaraLightOutput::brightness_levels brightness_levels = select_brightness_levels_(brightness, color_level);
+          *command = code;
+          return true;
+      }
 
-              ESP_LOGD(TAG, "Selected levels: color=%d => warm brightness=%d cool brightness=%d",
-                       color_level, brightness_levels.warm, brightness_levels.cool);
+      // Every command but off sets a channel's level
+      ir_light_base::command_type SaraProfile::command_type_of(uint16_t command) {
+          return command == CMD_OFF ? ir_light_base::COMMAND_POWER : ir_light_base::COMMAND_ABSOLUTE;
+      }
 
-              uint16_t cool_cmd = CMDS_COOL[brightness_levels.cool];
-              uint16_t warm_cmd = CMDS_WARM[brightness_levels.warm];
+      // The color temperature of each color level
+      static const float LEVEL_MIREDS[] PROGMEM = { 154, 167, 182, 244, 370 };
 
+      void SaraProfile::describe(const SaraState &state, const ir_light_base::QuantizeOptions &options,
+                                 float *brightness, float *mireds) {
+          if (state.power == ir_light_base::POWER_OFF) {
+              *brightness = 0.0f;
+              return;
+          }
 
-              send_command_(warm_cmd);
-              delay(COMMAND_DELAY);
-              send_command_(cool_cmd);
+          // The brighter channel's level takes the light's brightness. At the
+          // in-between colors the other channel gets half of it, so the
+          // brightness also has to be twice a value in that channel's level.
+          color_level color = color_level_of(state.levels);
+          float low, high;
+          ir_light_base::uniform_range(std::max(state.levels.warm, state.levels.cool), BRT_MAX + 1,
+                                       options.round_brightness, &low, &high);
+          if (color == CT_COOLER || color == CT_WARMER) {
+              float half_low, half_high;
+              ir_light_base::uniform_range(std::min(state.levels.warm, state.levels.cool), BRT_MAX + 1,
+                                           options.round_brightness, &half_low, &half_high);
+              // Levels set from the remote may not be a pair quantize() makes.
+              // The top level includes 1, so the ranges may meet only there.
+              if (2 * half_low <= high && 2 * half_high > low) {
+                  low = std::max(low, 2 * half_low);
+                  high = std::min(high, 2 * half_high);
+              }
           }
+
+          *brightness = (low + high) / 2.0f;
+          *mireds = table_read(&LEVEL_MIREDS[color]);
+      }
+
+      // The remote sets each channel independently, so this picks the nearest
+      // of the color levels quantize() produces
+      color_level SaraProfile::color_level_of(const brightness_levels &levels) {
+          if (levels.warm == BRT_MIN && levels.cool > BRT_MIN) {
+              return CT_COOL;
+          } else if (levels.cool == BRT_MIN && levels.warm > BRT_MIN) {
+              return CT_WARM;
+          } else if (levels.warm == levels.cool) {
+              return CT_WHITE;
+          }
+          return levels.cool > levels.warm ? CT_COOLER : CT_WARMER;
       }
 
-      void SaraLightOutput::dump_config() {
-          ESP_LOGCONFIG(TAG, "Sara IR Ceiling Light");
+      int SaraProfile::level_change(brightness_level from, brightness_level to) {
+          if (from == BRT_UNKNOWN) {
+              return BRT_MAX + 1;
+          }
+          return abs(to - from);
       }
 
       // Interpolating points between the color levels in Kelvin
       // (since HA's CT selectors are linear in Kelvin):
       // (6500) 6250 (6000) 5750 (5500) 4800 (4100) 3400 (2700) K
       // (154)  160  (167)  174  (182)  208  (244)  294  (370) mired
-      static const float CT_THRESHOLDS[] = { 160, 174, 208, 294 };
+      static const float CT_THRESHOLDS[] PROGMEM = { 160, 174, 208, 294 };
 
-      SaraLightOutput::color_level SaraLightOutput::select_color_level_(float mired_val) {
-          for(int i = CT_COOL; i < CT_WARM; ++i) {
-              if (mired_val < CT_THRESHOLDS[i]) {
-                  return (color_level) i;
-              }
-          }
-          return CT_WARM;
+      color_level SaraProfile::select_color_level(float mired_val, int previous, float hysteresis) {
+          return (color_level) ir_light_base::threshold_index(mired_val, CT_THRESHOLDS, false, previous, hysteresis);
       }
 
-      SaraLightOutput::brightness_levels SaraLightOutput::select_brightness_levels_(float brightness_val, SaraLightOutput::color_level color) {
+      brightness_levels SaraProfile::select_brightness_levels(float brightness_val, color_level color,
+                                                              const brightness_levels &previous,
+                                                              const ir_light_base::QuantizeOptions &options) {
           float cool_brightness_val = 1.0, warm_brightness_val = 1.0;
           brightness_levels levels;
 
@@ -152,26 +269,16 @@ namespace esphome {
               break;
           };
 
-          levels.cool = round_brightness_level_(cool_brightness_val);
-          levels.warm = round_brightness_level_(warm_brightness_val);
+          levels.cool = round_brightness_level(cool_brightness_val, previous.cool, options);
+          levels.warm = round_brightness_level(warm_brightness_val, previous.warm, options);
 
           return levels;
       }
 
-      SaraLightOutput::brightness_level SaraLightOutput::round_brightness_level_(float brightness_val) {
-          brightness_level brightness = (brightness_level) (brightness_val * 10.0);
-          return std::min(brightness, BRT_MAX);
-      }
-
-      void SaraLightOutput::send_command_(uint16_t command) {
-          send_nec_(ADDR, command);
-      }
-
-      void SaraLightOutput::send_nec_(uint16_t address, uint16_t command) {
-          auto transmit = this->emitter_->transmit();
-          remote_base::NECData data{address, command, 1};
-          remote_base::NECProtocol().encode(transmit.get_data(), data);
-          transmit.perform();
+      brightness_level SaraProfile::round_brightness_level(float brightness_val, brightness_level previous,
+                                                           const ir_light_base::QuantizeOptions &options) {
+          return (brightness_level) ir_light_base::uniform_level(brightness_val, BRT_MAX + 1, options.round_brightness,
+                                                                 previous, options.brightness_hysteresis);
       }
   }
 }
@@ -1,48 +1,72 @@
 #pragma once
 
-#include "esphome/core/component.h"
-#include "esphome/components/light/light_output.h"
-#include "esphome/components/remote_transmitter/remote_transmitter.h"
+#include <vector>
+
+#include "esphome/components/ir_light_base/ir_light_output.h"
 
 namespace esphome {
   namespace sara_light {
-    class SaraLightOutput : public light::LightOutput, public Component {
-    public:
-      light::LightTraits get_traits() override;
-      void write_state(light::LightState *state) override;
-      void dump_config() override;
-      void set_transmitter(remote_transmitter::RemoteTransmitterComponent *emitter) { emitter_ = emitter; }
-
-    private:
-      // Light is internally represented as two completely independent lights,
-      // one warm and one cool. We map that into five levels, where the
-      // intermediate states represent "half-brightness".
-      enum color_level {
-        CT_COOL = 0,
-        CT_COOLER,
-        CT_WHITE,
-        CT_WARMER,
-        CT_WARM,
-      };
-
-      // Light has 10 selectable brightness levels for each color
-      enum brightness_level {
-        BRT_MIN = 0,
-        BRT_MAX = 9,
-      };
-
-      struct brightness_levels {
-        brightness_level warm;
-        brightness_level cool;
-      };
-
-      color_level select_color_level_(float mired_val);
-      brightness_levels select_brightness_levels_(float brightness_val, color_level color);
-      brightness_level round_brightness_level_(float brightness_val);
-      void send_command_(uint16_t command);
-      void send_nec_(uint16_t address, uint16_t command);
-
-      esphome::remote_transmitter::RemoteTransmitterComponent *emitter_{nullptr};
+    // Light is internally represented as two completely independent lights,
+    // one warm and one cool. We map that into five levels, where the
+    // intermediate states represent "half-brightness".
+    enum color_level {
+      CT_COOL = 0,
+      CT_COOLER,
+      CT_WHITE,
+      CT_WARMER,
+      CT_WARM,
+    };
+
+    // Light has 10 selectable brightness levels for each color
+    enum brightness_level {
+      BRT_UNKNOWN = -1,
+      BRT_MIN = 0,
+      BRT_MAX = 9,
+    };
+
+    struct brightness_levels {
+      brightness_level warm;
+      brightness_level cool;
+    };
+
+    struct SaraState {
+      ir_light_base::power_state power { ir_light_base::POWER_UNKNOWN };
+      brightness_levels levels { BRT_UNKNOWN, BRT_UNKNOWN };
+
+      bool known() const { return levels.warm != BRT_UNKNOWN && levels.cool != BRT_UNKNOWN; }
     };
+
+    struct SaraProfile {
+      using State = SaraState;
+
+      static const char *const TAG;
+      static const char *const NAME;
+      static const size_t FRAME_TABLE_BYTES;
+      static const uint16_t ADDRESS = 0xC580;
+      static constexpr float MIN_MIREDS = 154;
+      static constexpr float MAX_MIREDS = 370;
+      static const uint16_t COMMAND_GAP = 500;
+
+      static State quantize(light::LightState *state, const State &previous, const ir_light_base::QuantizeOptions &options);
+      static void plan(const State &from, const State &to, std::vector<ir_light_base::IrCommand> *commands);
+      static void apply(State *state, uint16_t command);
+      static const ir_light_base::NecFrameTimings *frame(uint16_t command, uint8_t channel);
+      static bool decode(uint16_t code, uint8_t channel, uint16_t *command);
+      static void describe(const State &state, const ir_light_base::QuantizeOptions &options, float *brightness,
+                           float *mireds);
+      static State off(const State &state) { return State{ir_light_base::POWER_OFF, state.levels}; }
+      static ir_light_base::command_type command_type_of(uint16_t command);
+      static bool holdable(uint16_t command) { return false; }
+
+      static color_level select_color_level(float mired_val, int previous, float hysteresis);
+      static color_level color_level_of(const brightness_levels &levels);
+      static brightness_levels select_brightness_levels(float brightness_val, color_level color, const brightness_levels &previous,
+                                                        const ir_light_base::QuantizeOptions &options);
+      static brightness_level round_brightness_level(float brightness_val, brightness_level previous,
+                                                     const ir_light_base::QuantizeOptions &options);
+      static int level_change(brightness_level from, brightness_level to);
+    };
+
+    using SaraLightOutput = ir_light_base::IrLightOutput<SaraProfile>;
   }
 }
@@ -0,0 +1,43 @@
+// The same sweeps as test_sweep, timed, with what they sent as counters
+
+#include <benchmark/benchmark.h>
+
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+#include "harness/sweep.h"
+
+using namespace ir_light_test;
+
+static void report(benchmark::State &state, const RunMetrics &metrics) {
+  state.counters["frames"] = metrics.frames;
+  state.counters["repeats"] = metrics.repeats;
+  state.counters["blocked_ms"] = metrics.blocked_us / 1000.0;
+  state.counters["worst_block_ms"] = metrics.worst_block_us / 1000.0;
+  state.counters["worst_latency_ms"] = metrics.worst_latency_us / 1000.0;
+}
+
+template<typename Profile> static void BM_Grid(benchmark::State &state) {
+  SweepResult result;
+  for (auto _ : state) {
+    result = sweep<Profile>(1);
+  }
+  report(state, result.metrics);
+}
+
+template<typename Profile> static void BM_Fade(benchmark::State &state) {
+  SweepResult result;
+  for (auto _ : state) {
+    result = fade<Profile>(2, 20, 1000);
+  }
+  report(state, result.metrics);
+}
+
+BENCHMARK_TEMPLATE(BM_Grid, esphome::nec_light::NecProfile)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Grid, esphome::sara_light::SaraProfile)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Grid, esphome::photo_light::PhotoProfile)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Fade, esphome::nec_light::NecProfile)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Fade, esphome::sara_light::SaraProfile)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Fade, esphome::photo_light::PhotoProfile)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+#include "fixture_models.h"
+#include "light_rig.h"
+
+namespace ir_light_test {
+  using esphome::ir_light_base::POWER_OFF;
+  using esphome::ir_light_base::POWER_ON;
+  using esphome::ir_light_base::POWER_UNKNOWN;
+  using esphome::ir_light_base::power_state;
+
+  // Per profile: the fixture, what it shows in each state the driver tracks,
+  // the states a run starts from and the targets it goes to
+  template<uint8_t Channel, uint8_t HoldRepeats> struct NecCase {
+    using Profile = esphome::nec_light::NecProfile;
+    using State = Profile::State;
+    using Fixture = NecFixture;
+
+    // The fixture takes two repeat codes as one more step of a held button
+    static Fixture make_fixture() { return Fixture(Channel, 2); }
+
+    static void configure(TestOutput<Profile> *light) {
+      light->set_channel(Channel);
+      light->set_hold_repeats(HoldRepeats);
+    }
+
+    static Fixture::State shows(const State &state) {
+      return Fixture::State{state.power == POWER_ON, state.color, state.brightness};
+    }
+
+    // A fixture state matching what the driver knows, random where it
+    // doesn't know
+    static Fixture::State physical(const State &state, std::mt19937 &rng) {
+      bool on = state.power == POWER_UNKNOWN ? rng() % 2 : state.power == POWER_ON;
+      int color = state.color >= 0 ? state.color : rng() % 5;
+      int brightness = state.brightness >= 0 ? state.brightness : rng() % 10;
+      return Fixture::State{on, color, brightness};
+    }
+
+    static std::vector<State> starts() {
+      std::vector<State> states{State{}};
+      for (power_state power : {POWER_UNKNOWN, POWER_OFF, POWER_ON}) {
+        for (int color = 0; color < 5; ++color) {
+          for (int brightness = 0; brightness < 10; ++brightness) {
+            states.push_back(State{power, (esphome::nec_light::color_level) color,
+                                   (esphome::nec_light::brightness_level) brightness});
+          }
+        }
+      }
+      return states;
+    }
+
+    static std::vector<State> targets() {
+      std::vector<State> states{State{POWER_OFF}};
+      for (int color = 0; color < 5; ++color) {
+        for (int brightness = 0; brightness < 10; ++brightness) {
+          states.push_back(State{POWER_ON, (esphome::nec_light::color_level) color,
+                                 (esphome::nec_light::brightness_level) brightness});
+        }
+      }
+      return states;
+    }
+
+    // A lit state the planner reaches with every type of command, to
+    // calibrate from
+    static State calibration_start() {
+      return State{POWER_ON, esphome::nec_light::CT_REFRESH, (esphome::nec_light::brightness_level) 3};
+    }
+    static bool calibrates(esphome::ir_light_base::command_type type) { return true; }
+  };
+
+  struct SaraCase {
+    using Profile = esphome::sara_light::SaraProfile;
+    using State = Profile::State;
+    using Fixture = SaraFixture;
+
+    static Fixture make_fixture() { return Fixture(); }
+    static void configure(TestOutput<Profile> *light) {}
+
+    static Fixture::State shows(const State &state) {
+      return Fixture::State{state.power == POWER_ON, state.levels.warm, state.levels.cool};
+    }
+
+    static Fixture::State physical(const State &state, std::mt19937 &rng) {
+      bool on = state.power == POWER_UNKNOWN ? rng() % 2 : state.power == POWER_ON;
+      int warm = state.levels.warm >= 0 ? state.levels.warm : rng() % 10;
+      int cool = state.levels.cool >= 0 ? state.levels.cool : rng() % 10;
+      return Fixture::State{on, warm, cool};
+    }
+
+    static State state(power_state power, int warm, int cool) {
+      return State{power, {(esphome::sara_light::brightness_level) warm, (esphome::sara_light::brightness_level) cool}};
+    }
+
+    static std::vector<State> starts() {
+      std::vector<State> states{state(POWER_UNKNOWN, -1, -1)};
+      for (power_state power : {POWER_UNKNOWN, POWER_OFF, POWER_ON}) {
+        for (int warm = 0; warm < 10; ++warm) {
+          for (int cool = 0; cool < 10; ++cool) {
+            states.push_back(state(power, warm, cool));
+          }
+        }
+      }
+      return states;
+    }
+
+    // Any pair of levels, the driver quantizes them to the pairs it sets
+    static std::vector<State> targets() {
+      std::vector<State> states{state(POWER_OFF, 0, 0)};
+      for (int warm = 0; warm < 10; ++warm) {
+        for (int cool = 0; cool < 10; ++cool) {
+          states.push_back(state(POWER_ON, warm, cool));
+        }
+      }
+      return states;
+    }
+
+    // Every level command is absolute
+    static State calibration_start() { return state(POWER_ON, 6, 3); }
+    static bool calibrates(esphome::ir_light_base::command_type type) {
+      return type != esphome::ir_light_base::COMMAND_RELATIVE;
+    }
+  };
+
+  struct PhotoCase {
+    using Profile = esphome::photo_light::PhotoProfile;
+    using State = Profile::State;
+    using Fixture = PhotoFixture;
+
+    static Fixture make_fixture() { return Fixture(); }
+    static void configure(TestOutput<Profile> *light) {}
+
+    // The driver's color settings as base and tint, and its brightness
+    // settings above off
+    static Fixture::State shows(const State &state) {
+      if (state.brightness <= 0) {
+        return Fixture::State{false, Fixture::COLD, 0, Fixture::SLEEP};
+      }
+      static const Fixture::Base BASES[] = {
+        Fixture::COLD, Fixture::COLD, Fixture::WHITE, Fixture::WHITE, Fixture::WHITE, Fixture::WARM, Fixture::WARM,
+      };
+      static const int TINTS[] = {0, 1, -1, 0, 1, -1, 0};
+      static const Fixture::Brightness BRIGHTNESSES[] = {
+        Fixture::SLEEP, Fixture::SLEEP, Fixture::PERCENT_50, Fixture::PERCENT_100,
+      };
+      return Fixture::State{true, BASES[state.color], TINTS[state.color], BRIGHTNESSES[state.brightness]};
+    }
+
+    static Fixture::State physical(const State &state, std::mt19937 &rng) {
+      Fixture::State fixture{rng() % 2 == 0, (Fixture::Base) (rng() % 3), (int) (rng() % 3) - 1,
+                             (Fixture::Brightness) (rng() % 4)};
+      if (state.color >= 0) {
+        Fixture::State known = shows(State{state.color, 1});
+        fixture.base = known.base;
+        fixture.tint = known.tint;
+      }
+      if (state.brightness >= 0) {
+        fixture.on = state.brightness > 0;
+        if (fixture.on) {
+          fixture.brightness = shows(State{0, state.brightness}).brightness;
+        }
+      }
+      return fixture;
+    }
+
+    static std::vector<State> starts() {
+      std::vector<State> states;
+      for (int color = -1; color < 7; ++color) {
+        for (int brightness = -1; brightness < 4; ++brightness) {
+          states.push_back(State{color, brightness});
+        }
+      }
+      return states;
+    }
+
+    static std::vector<State> targets() {
+      std::vector<State> states;
+      for (int color = 0; color < 7; ++color) {
+        for (int brightness = 0; brightness < 4; ++brightness) {
+          states.push_back(State{color, brightness});
+        }
+      }
+      return states;
+    }
+
+    // Turning off goes through sleep brightness first, so no tint command
+    // is ever followed by one turning the light on or off
+    static State calibration_start() { return State{4, 2}; }
+    static bool calibrates(esphome::ir_light_base::command_type type) {
+      return type != esphome::ir_light_base::COMMAND_RELATIVE;
+    }
+  };
+}
@@ -0,0 +1,208 @@
+#include "fixture_models.h"
+
+#include <algorithm>
+
+namespace ir_light_test {
+  void FixtureModel::listen(RecordingTransmitter *transmitter) {
+    transmitter->add_listener([this](const Transmission &transmission) { receive(transmission); });
+  }
+
+  void FixtureModel::receive(const Transmission &transmission) {
+    for (const IrCode &code : split_codes(transmission.raw)) {
+      uint64_t at = transmission.start_us + code.offset_us;
+      if (!code.repeat) {
+        bool lost = code.address == address_ && recovery_ && taken_frame_ &&
+                    at < last_frame_end_us_ + recovery_(last_command_);
+        // Any other frame ends a held button, even one for another device
+        holding_ = code.address == address_ && !lost && on_command(code.command);
+        if (holding_) {
+          commands_++;
+          held_command_ = code.command;
+          held_repeats_ = 0;
+          taken_frame_ = true;
+          last_command_ = code.command;
+          last_frame_end_us_ = at + code.duration_us;
+        }
+      } else if (holding_ && at - last_code_us_ <= HOLD_TIMEOUT_US) {
+        uint32_t per_step = repeats_per_step(held_command_);
+        if (per_step > 0 && ++held_repeats_ % per_step == 0) {
+          on_command(held_command_);
+          commands_++;
+        }
+      } else {
+        holding_ = false;
+      }
+      last_code_us_ = at;
+    }
+  }
+
+  namespace nec {
+    static const uint16_t ON = 0x42bd;
+    static const uint16_t OFF = 0x41be;
+    static const uint16_t MAX_WARM = 0x51ae;
+    static const uint16_t MAX_WHITE = 0x52ad;
+    static const uint16_t MID_WHITE = 0x5da2;
+    static const uint16_t MAX_COOL = 0x53ac;
+    static const uint16_t BRIGHTER = 0x45ba;
+    static const uint16_t DIMMER = 0x44bb;
+    static const uint16_t DIMMEST = 0x1de2;
+    static const uint16_t WARMER = 0x57a8;
+    static const uint16_t COOLER = 0x58a7;
+    static const uint16_t BUTTONS[] = {
+      ON, OFF, MAX_WARM, MAX_WHITE, MID_WHITE, MAX_COOL, BRIGHTER, DIMMER, DIMMEST, WARMER, COOLER,
+    };
+  }
+
+  NecFixture::NecFixture(uint8_t channel, uint32_t repeats_per_step)
+      : FixtureModel(0x6d82), channel_(channel), repeats_per_step_(repeats_per_step) {}
+
+  uint16_t NecFixture::button_(uint16_t command) const {
+    for (uint16_t button : nec::BUTTONS) {
+      // Channel 2 remotes set the top bit of the command and clear bit 7
+      uint16_t code = channel_ == 2 ? (uint16_t) ((button | 0x8000) & ~0x0080) : button;
+      if (code == command) {
+        return button;
+      }
+    }
+    return 0;
+  }
+
+  bool NecFixture::on_command(uint16_t command) {
+    uint16_t button = button_(command);
+    switch (button) {
+    case nec::ON: state_.on = true; return true;
+    case nec::OFF: state_.on = false; return true;
+    case nec::MAX_WARM: state_ = State{true, 4, 9}; return true;
+    case nec::MAX_WHITE: state_ = State{true, 2, 9}; return true;
+    case nec::MID_WHITE: state_ = State{true, 2, 5}; return true;
+    case nec::MAX_COOL: state_ = State{true, 0, 9}; return true;
+    case 0: return false;
+    }
+
+    // Steps only work while the light is on
+    if (!state_.on) {
+      return true;
+    }
+    switch (button) {
+    case nec::BRIGHTER: state_.brightness = std::min(state_.brightness + 1, 9); break;
+    case nec::DIMMER: state_.brightness = std::max(state_.brightness - 1, 0); break;
+    case nec::DIMMEST: state_.brightness = 0; break;
+    case nec::WARMER: state_.color = std::min(state_.color + 1, 4); break;
+    case nec::COOLER: state_.color = std::max(state_.color - 1, 0); break;
+    }
+    return true;
+  }
+
+  uint32_t NecFixture::repeats_per_step(uint16_t command) const {
+    uint16_t button = button_(command);
+    bool repeats = button == nec::BRIGHTER || button == nec::DIMMER || button == nec::WARMER || button == nec::COOLER;
+    return repeats ? repeats_per_step_ : 0;
+  }
+
+  namespace sara {
+    static const uint16_t OFF = 0xf708;
+    static const uint16_t WARM_LEVELS[] = {
+      0xa758, 0xa55a, 0xa35c, 0xa15e, 0x9f60, 0x9d62, 0x9b64, 0x9966, 0x9768, 0x956a,
+    };
+    static const uint16_t COOL_LEVELS[] = {
+      0x936c, 0x916e, 0x8f70, 0x8d72, 0x8b74, 0x8976, 0x8778, 0x857a, 0x837c, 0x817e,
+    };
+  }
+
+  SaraFixture::SaraFixture() : FixtureModel(0xc580) {}
+
+  bool SaraFixture::on_command(uint16_t command) {
+    if (command == sara::OFF) {
+      state_.on = false;
+      return true;
+    }
+    for (int level = 0; level < 10; ++level) {
+      if (command == sara::WARM_LEVELS[level]) {
+        state_.on = true;
+        state_.warm = level;
+        return true;
+      }
+      if (command == sara::COOL_LEVELS[level]) {
+        state_.on = true;
+        state_.cool = level;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  namespace photo {
+    static const uint16_t TOGGLE = 0xff00;
+    static const uint16_t BRIGHTNESS_100 = 0xf40b;
+    static const uint16_t BRIGHTNESS_50 = 0xf807;
+    static const uint16_t BRIGHTNESS_20 = 0xfc03;
+    static const uint16_t SLEEP = 0xf906;
+    static const uint16_t COLD = 0xb748;
+    static const uint16_t WHITE = 0xbb44;
+    static const uint16_t WARM = 0xbf40;
+    static const uint16_t WARMER = 0xf50a;
+    static const uint16_t COOLER = 0xfd02;
+  }
+
+  PhotoFixture::PhotoFixture() : FixtureModel(0xfe01) {}
+
+  bool PhotoFixture::on_command(uint16_t command) {
+    switch (command) {
+    case photo::TOGGLE: state_.on = !state_.on; return true;
+    case photo::BRIGHTNESS_100: state_.on = true; state_.brightness = PERCENT_100; return true;
+    case photo::BRIGHTNESS_50: state_.on = true; state_.brightness = PERCENT_50; return true;
+    case photo::BRIGHTNESS_20: state_.on = true; state_.brightness = PERCENT_20; return true;
+    case photo::SLEEP: state_.on = true; state_.brightness = SLEEP; return true;
+    case photo::COLD: state_ = State{true, COLD, 0, PERCENT_100}; return true;
+    case photo::WHITE: state_ = State{true, WHITE, 0, PERCENT_100}; return true;
+    case photo::WARM: state_ = State{true, WARM, 0, PERCENT_100}; return true;
+    case photo::WARMER:
+      if (state_.on) {
+        state_.tint = std::min(state_.tint + 1, 1);
+      }
+      return true;
+    case photo::COOLER:
+      if (state_.on) {
+        state_.tint = std::max(state_.tint - 1, -1);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool operator==(const NecFixture::State &a, const NecFixture::State &b) {
+    return a.on == b.on && (!a.on || (a.color == b.color && a.brightness == b.brightness));
+  }
+
+  bool operator==(const SaraFixture::State &a, const SaraFixture::State &b) {
+    return a.on == b.on && (!a.on || (a.warm == b.warm && a.cool == b.cool));
+  }
+
+  bool operator==(const PhotoFixture::State &a, const PhotoFixture::State &b) {
+    return a.on == b.on && (!a.on || (a.base == b.base && a.tint == b.tint && a.brightness == b.brightness));
+  }
+
+  std::ostream &operator<<(std::ostream &os, const NecFixture::State &state) {
+    if (!state.on) {
+      return os << "off";
+    }
+    return os << "color " << state.color << ", brightness " << state.brightness;
+  }
+
+  std::ostream &operator<<(std::ostream &os, const SaraFixture::State &state) {
+    if (!state.on) {
+      return os << "off";
+    }
+    return os << "warm " << state.warm << ", cool " << state.cool;
+  }
+
+  std::ostream &operator<<(std::ostream &os, const PhotoFixture::State &state) {
+    if (!state.on) {
+      return os << "off";
+    }
+    static const char *const BASES[] = {"cold", "white", "warm"};
+    static const char *const BRIGHTNESSES[] = {"sleep", "20%", "50%", "100%"};
+    return os << BASES[state.base] << (state.tint > 0 ? "+" : state.tint < 0 ? "-" : "") << ", "
+              << BRIGHTNESSES[state.brightness];
+  }
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+#include "esphome/components/ir_light_base/gap_calibration.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/core/hal.h"
+#include "recording_transmitter.h"
+
+namespace ir_light_test {
+  // Simulated fixtures, fed with what a transmitter actually sends. They
+  // are written from how the fixtures behave, with their own code tables,
+  // and share nothing with the profiles' planners or apply(), so a planner
+  // and a model can't agree on a mistake.
+  class FixtureModel {
+  public:
+    explicit FixtureModel(uint16_t address) : address_(address) {}
+    virtual ~FixtureModel() = default;
+
+    // Receive everything the transmitter sends from now on
+    void listen(RecordingTransmitter *transmitter);
+    void receive(const Transmission &transmission);
+
+    // Frames and repeat codes the fixture acted on
+    uint32_t commands() const { return commands_; }
+
+    // Time in us the fixture needs after a frame before it takes the next
+    // one, by the command it took. Frames coming sooner are lost.
+    void set_recovery(std::function<uint32_t(uint16_t command)> recovery) { recovery_ = std::move(recovery); }
+
+    // NEC repeat codes follow each other every 108ms; a longer pause ends a
+    // held button
+    static const uint64_t HOLD_TIMEOUT_US = 120000;
+
+  protected:
+    // A frame with the fixture's address. Returns whether the fixture knows
+    // the command.
+    virtual bool on_command(uint16_t command) = 0;
+    // Repeat codes the fixture takes as one more press of a held button, 0
+    // if holding the button doesn't repeat the command
+    virtual uint32_t repeats_per_step(uint16_t command) const { return 0; }
+
+    uint16_t address_;
+    uint32_t commands_{0};
+    std::function<uint32_t(uint16_t command)> recovery_;
+    // The last frame the fixture took, for the recovery time after it
+    bool taken_frame_{false};
+    uint16_t last_command_{0};
+    uint64_t last_frame_end_us_{0};
+    // The button being held, while repeat codes keep coming
+    bool holding_{false};
+    uint16_t held_command_{0};
+    uint32_t held_repeats_{0};
+    uint64_t last_code_us_{0};
+  };
+
+  // The ceiling light behind nec_light: five color temperatures by ten
+  // brightness steps. Steps saturate at the ends of each range and are
+  // ignored while off; the preset buttons turn the light on.
+  class NecFixture : public FixtureModel {
+  public:
+    struct State {
+      bool on;
+      // 0 is the coolest color and the dimmest brightness
+      int color;
+      int brightness;
+    };
+
+    NecFixture(uint8_t channel, uint32_t repeats_per_step);
+    const State &state() const { return state_; }
+    void set_state(const State &state) { state_ = state; }
+
+  protected:
+    bool on_command(uint16_t command) override;
+    uint32_t repeats_per_step(uint16_t command) const override;
+    // The channel 1 code for a code sent to this fixture's channel
+    uint16_t button_(uint16_t command) const;
+
+    uint8_t channel_;
+    uint32_t repeats_per_step_;
+    State state_{};
+  };
+
+  // The ceiling light behind sara_light: separate warm and cool LED
+  // channels, each set to one of ten levels by its own button. Setting
+  // either channel turns the light on with the other channel where it was.
+  class SaraFixture : public FixtureModel {
+  public:
+    struct State {
+      bool on;
+      int warm;
+      int cool;
+    };
+
+    SaraFixture();
+    const State &state() const { return state_; }
+    void set_state(const State &state) { state_ = state; }
+
+  protected:
+    bool on_command(uint16_t command) override;
+
+    State state_{};
+  };
+
+  // The bulb behind photo_light. Three base colors, each of which also
+  // resets brightness to 100%, a tint one step warmer or cooler than the
+  // base, four brightness settings and a power toggle.
+  class PhotoFixture : public FixtureModel {
+  public:
+    enum Base { COLD, WHITE, WARM };
+    enum Brightness { SLEEP, PERCENT_20, PERCENT_50, PERCENT_100 };
+
+    struct State {
+      bool on;
+      Base base;
+      // -1 cooler, 0 none, 1 warmer
+      int tint;
+      Brightness brightness;
+    };
+
+    PhotoFixture();
+    const State &state() const { return state_; }
+    void set_state(const State &state) { state_ = state; }
+
+  protected:
+    bool on_command(uint16_t command) override;
+
+    State state_{};
+  };
+
+  // Calibration feedback read straight off a fixture, as a light sensor
+  // watching it would
+  template<typename Fixture> class FixtureGapFeedback : public esphome::ir_light_base::GapFeedback {
+  public:
+    explicit FixtureGapFeedback(const Fixture *fixture) : fixture_(fixture) {}
+    bool trial_passed(bool lit) override { return fixture_->state().on == lit; }
+
+  protected:
+    const Fixture *fixture_;
+  };
+
+  // A light sensor watching a fixture that, like real ones, only publishes
+  // every interval_ms, so its reading can lag the light by that long.
+  // update() is called as time passes; a stopped sensor publishes nothing.
+  template<typename Fixture> class FixtureLightSensor : public esphome::sensor::Sensor {
+  public:
+    FixtureLightSensor(const Fixture *fixture, uint32_t interval_ms) : fixture_(fixture), interval_ms_(interval_ms) {}
+    void set_stopped(bool stopped) { stopped_ = stopped; }
+
+    void update() {
+      uint32_t now = esphome::millis();
+      if (stopped_ || (this->publishes > 0 && now - last_publish_ < interval_ms_)) {
+        return;
+      }
+      last_publish_ = now;
+      this->publish_state(fixture_->state().on ? 100.0f : 0.0f);
+    }
+
+  protected:
+    const Fixture *fixture_;
+    uint32_t interval_ms_;
+    bool stopped_{false};
+    uint32_t last_publish_{0};
+  };
+
+  // Compare what two states show, levels only counting while on
+  bool operator==(const NecFixture::State &a, const NecFixture::State &b);
+  bool operator==(const SaraFixture::State &a, const SaraFixture::State &b);
+  bool operator==(const PhotoFixture::State &a, const PhotoFixture::State &b);
+  std::ostream &operator<<(std::ostream &os, const NecFixture::State &state);
+  std::ostream &operator<<(std::ostream &os, const SaraFixture::State &state);
+  std::ostream &operator<<(std::ostream &os, const PhotoFixture::State &state);
+}
@@ -0,0 +1,128 @@
+#include "light_rig.h"
+
+#include "esphome/core/helpers.h"
+
+namespace ir_light_test {
+  using esphome::ir_light_base::IrLightOutputBase;
+
+  Rig::Rig(size_t transmitters) {
+    VirtualClock::reset();
+    for (size_t i = 0; i < transmitters; ++i) {
+      transmitters_.push_back(std::make_unique<RecordingTransmitter>());
+      scheduler_.add_transmitter(transmitters_.back().get());
+    }
+    transmitters_[0]->add_listener([this](const Transmission &transmission) { on_transmission_(transmission); });
+  }
+
+  void Rig::add_light_(std::unique_ptr<esphome::light::LightOutput> owner, IrLightOutputBase *output,
+                       const char *name) {
+    auto state = std::make_unique<esphome::light::LightState>(output);
+    state->set_name(name);
+    output->set_scheduler(&scheduler_);
+    receiver_.register_listener(output);
+    lights_.push_back(Light{std::move(owner), output, std::move(state)});
+  }
+
+  void Rig::setup() {
+    for (auto &light : lights_) {
+      light.state->setup();
+    }
+  }
+
+  esphome::light::LightState *Rig::light_state(IrLightOutputBase *output) {
+    for (auto &light : lights_) {
+      if (light.output == output) {
+        return light.state.get();
+      }
+    }
+    return nullptr;
+  }
+
+  void Rig::set(IrLightOutputBase *output, float brightness, float mireds) {
+    auto call = light_state(output)->make_call();
+    call.set_state(brightness > 0.0f);
+    if (brightness > 0.0f) {
+      call.set_brightness(brightness);
+    }
+    call.set_color_temperature(mireds);
+    call.perform();
+
+    metrics_.states_set++;
+    pending_ = true;
+    last_set_us_ = VirtualClock::now_us();
+  }
+
+  void Rig::on_transmission_(const Transmission &transmission) {
+    if (loopback_) {
+      receiver_.inject(transmission.raw);
+    }
+    metrics_.transmissions++;
+    for (const IrCode &code : split_codes(transmission.raw)) {
+      if (code.repeat) {
+        metrics_.repeats++;
+      } else {
+        metrics_.frames++;
+      }
+    }
+    last_transmission_end_us_ = transmission.start_us + transmission.duration_us;
+  }
+
+  void Rig::step() {
+    uint64_t start = VirtualClock::now_us();
+    scheduler_.loop();
+    receiver_.loop();
+    for (auto &light : lights_) {
+      light.output->loop();
+    }
+    uint64_t blocked = VirtualClock::now_us() - start;
+    metrics_.blocked_us += blocked;
+    if (blocked > metrics_.worst_block_us) {
+      metrics_.worst_block_us = blocked;
+    }
+
+    VirtualClock::advance_us(esphome::HighFrequencyLoopRequester::is_high_frequency() ? HIGH_FREQUENCY_INTERVAL_US
+                                                                                      : LOOP_INTERVAL_US);
+  }
+
+  void Rig::run_for(uint32_t ms) {
+    uint64_t end = VirtualClock::now_us() + (uint64_t) ms * 1000;
+    while (VirtualClock::now_us() < end) {
+      step();
+    }
+    update_latency_();
+  }
+
+  bool Rig::idle() {
+    for (auto &light : lights_) {
+      if (!scheduler_.is_idle(light.output)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Rig::run_until_idle(uint32_t settle_ms, uint32_t timeout_ms) {
+    uint64_t timeout = VirtualClock::now_us() + (uint64_t) timeout_ms * 1000;
+    uint64_t quiet_since = VirtualClock::now_us();
+    while (VirtualClock::now_us() < timeout) {
+      step();
+      if (!idle()) {
+        quiet_since = VirtualClock::now_us();
+      } else if (VirtualClock::now_us() - quiet_since >= (uint64_t) settle_ms * 1000) {
+        break;
+      }
+    }
+    update_latency_();
+  }
+
+  void Rig::update_latency_() {
+    if (!pending_ || !idle()) {
+      return;
+    }
+    pending_ = false;
+    if (last_transmission_end_us_ > last_set_us_ &&
+        last_transmission_end_us_ - last_set_us_ > metrics_.worst_latency_us) {
+      metrics_.worst_latency_us = last_transmission_end_us_ - last_set_us_;
+    }
+  }
+}
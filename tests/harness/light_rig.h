@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "esphome/components/ir_light_base/ir_light_output.h"
+#include "esphome/components/ir_light_base/ir_scheduler.h"
+#include "esphome/components/light/light_state.h"
+#include "recording_transmitter.h"
+#include "virtual_clock.h"
+
+namespace ir_light_test {
+  // A light driven by a profile, opened up for the harness to inspect
+  template<typename Profile> class TestOutput : public esphome::ir_light_base::IrLightOutput<Profile> {
+  public:
+    using State = typename Profile::State;
+
+    const State &device_state() const { return this->current_; }
+    void set_device_state(const State &state) { this->current_ = state; }
+    const esphome::ir_light_base::QuantizeOptions &quantize_options() const { return this->quantize_options_; }
+    const esphome::ir_light_base::CommandGaps &command_gaps() const { return this->command_gaps_; }
+    uint32_t frames_sent() const { return this->frames_sent_; }
+    uint64_t blocked_us() const { return this->blocked_us_; }
+    uint32_t max_blocked_us() const { return this->max_blocked_us_; }
+    uint32_t resyncs() const { return this->resyncs_; }
+
+    // The State the device should end up in for the light's current values
+    State target() const {
+      return Profile::quantize(this->light_state_, this->current_, this->quantize_options_);
+    }
+
+    // Publish the tracked state back to the light, as a frame from the
+    // remote does
+    void publish_device_state() {
+      float brightness, mireds;
+      Profile::describe(this->current_, this->quantize_options_, &brightness, &mireds);
+      this->publish_device_state_(brightness, mireds);
+    }
+
+    // Commands still needed to get from the tracked state to the target
+    std::vector<esphome::ir_light_base::IrCommand> remaining() const {
+      std::vector<esphome::ir_light_base::IrCommand> commands;
+      Profile::plan(this->current_, target(), &commands);
+      return commands;
+    }
+  };
+
+  // What a run cost, accumulated over every step since the last reset
+  struct RunMetrics {
+    // NEC frames and repeat codes seen on the first transmitter
+    uint32_t frames{0};
+    uint32_t repeats{0};
+    uint32_t transmissions{0};
+    // Time the main loop spent in the components, mostly blocked on the
+    // transmitters, in total and in the longest single loop
+    uint64_t blocked_us{0};
+    uint64_t worst_block_us{0};
+    // Longest time from the last state set before the lights went idle to
+    // the end of the last transmission
+    uint64_t worst_latency_us{0};
+    uint32_t states_set{0};
+  };
+
+  // One scheduler with its transmitters and lights, run from a simulated
+  // main loop on the virtual clock. Transmissions on the first transmitter
+  // are looped back into a receiver every light listens to.
+  class Rig {
+  public:
+    explicit Rig(size_t transmitters = 1);
+
+    template<typename Profile> TestOutput<Profile> *add_light(const char *name) {
+      auto output = std::make_unique<TestOutput<Profile>>();
+      TestOutput<Profile> *ptr = output.get();
+      add_light_(std::move(output), ptr, name);
+      return ptr;
+    }
+
+    // Set up every light, restoring its state from preferences
+    void setup();
+
+    // Write new values to a light, as a light call would. Brightness 0
+    // turns the light off.
+    void set(esphome::ir_light_base::IrLightOutputBase *output, float brightness, float mireds);
+    esphome::light::LightState *light_state(esphome::ir_light_base::IrLightOutputBase *output);
+
+    // One pass of the main loop, then the wait before the next one
+    void step();
+    void run_for(uint32_t ms);
+    // Step until every light has had no frames to send for settle_ms
+    void run_until_idle(uint32_t settle_ms = 500, uint32_t timeout_ms = 600000);
+    bool idle();
+
+    // Feed what the first transmitter sends back into the receiver
+    void set_loopback(bool loopback) { loopback_ = loopback; }
+
+    esphome::ir_light_base::IrScheduler *scheduler() { return &scheduler_; }
+    RecordingTransmitter *transmitter(size_t index = 0) { return transmitters_[index].get(); }
+    LoopbackReceiver *receiver() { return &receiver_; }
+    const RunMetrics &metrics() const { return metrics_; }
+    void reset_metrics() { metrics_ = RunMetrics{}; }
+
+    // Main loop interval, and the interval while a component asks for
+    // high frequency looping
+    static const uint32_t LOOP_INTERVAL_US = 16000;
+    static const uint32_t HIGH_FREQUENCY_INTERVAL_US = 1000;
+
+  protected:
+    struct Light {
+      std::unique_ptr<esphome::light::LightOutput> owner;
+      esphome::ir_light_base::IrLightOutputBase *output;
+      std::unique_ptr<esphome::light::LightState> state;
+    };
+
+    void add_light_(std::unique_ptr<esphome::light::LightOutput> owner,
+                    esphome::ir_light_base::IrLightOutputBase *output, const char *name);
+    void on_transmission_(const Transmission &transmission);
+    void update_latency_();
+
+    esphome::ir_light_base::IrScheduler scheduler_;
+    std::vector<std::unique_ptr<RecordingTransmitter>> transmitters_;
+    LoopbackReceiver receiver_;
+    std::vector<Light> lights_;
+    bool loopback_{true};
+    RunMetrics metrics_;
+    // Whether a state was set since the lights were last idle, when the
+    // last one was, and when the last transmission ended
+    uint64_t last_set_us_{0};
+    bool pending_{false};
+    uint64_t last_transmission_end_us_{0};
+  };
+}
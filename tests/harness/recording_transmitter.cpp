@@ -0,0 +1,107 @@
+#include "recording_transmitter.h"
+
+#include <cstdlib>
+
+#include "virtual_clock.h"
+
+namespace ir_light_test {
+  static const uint8_t TOLERANCE = 25;
+
+  static bool near(int32_t value, int32_t expected) {
+    if ((value > 0) != (expected > 0)) {
+      return false;
+    }
+    int32_t value_abs = abs(value), expected_abs = abs(expected);
+    return value_abs >= expected_abs * (100 - TOLERANCE) / 100 && value_abs <= expected_abs * (100 + TOLERANCE) / 100;
+  }
+
+  RawTimings encode_nec(uint16_t address, uint16_t command) {
+    RawTimings raw{9000, -4500};
+    uint32_t bits = address | ((uint32_t) command << 16);
+    for (int bit = 0; bit < 32; ++bit) {
+      raw.push_back(560);
+      raw.push_back(((bits >> bit) & 1) ? -1690 : -560);
+    }
+    raw.push_back(560);
+    return raw;
+  }
+
+  RawTimings encode_nec_repeat() { return RawTimings{9000, -2250, 560}; }
+
+  std::vector<IrCode> split_codes(const RawTimings &raw) {
+    std::vector<IrCode> codes;
+    uint64_t offset = 0;
+    size_t i = 0;
+    while (i < raw.size()) {
+      if (i + 2 < raw.size() && near(raw[i], 9000) && near(raw[i + 1], -2250) && near(raw[i + 2], 560)) {
+        codes.push_back(IrCode{offset, 9000 + 2250 + 560, true, 0, 0});
+      } else if (i + 66 < raw.size() && near(raw[i], 9000) && near(raw[i + 1], -4500)) {
+        uint32_t bits = 0;
+        bool valid = near(raw[i + 66], 560);
+        for (int bit = 0; bit < 32 && valid; ++bit) {
+          valid = near(raw[i + 2 + bit * 2], 560);
+          if (near(raw[i + 3 + bit * 2], -1690)) {
+            bits |= 1UL << bit;
+          } else if (!near(raw[i + 3 + bit * 2], -560)) {
+            valid = false;
+          }
+        }
+        if (valid) {
+          uint64_t duration = 0;
+          for (size_t j = i; j <= i + 66; ++j) {
+            duration += abs(raw[j]);
+          }
+          codes.push_back(IrCode{offset, duration, false, (uint16_t) (bits & 0xffff), (uint16_t) (bits >> 16)});
+        }
+      }
+      offset += abs(raw[i]);
+      i++;
+    }
+    return codes;
+  }
+
+  void RecordingTransmitter::send_internal(uint32_t send_times, uint32_t send_wait) {
+    Transmission transmission{VirtualClock::now_us(), 0, temp_.get_carrier_frequency(), {}};
+    for (uint32_t i = 0; i < send_times; ++i) {
+      if (i > 0) {
+        transmission.raw.push_back(-(int32_t) send_wait);
+      }
+      transmission.raw.insert(transmission.raw.end(), temp_.get_data().begin(), temp_.get_data().end());
+    }
+    for (int32_t length : transmission.raw) {
+      transmission.duration_us += abs(length);
+    }
+
+    VirtualClock::advance_us(transmission.duration_us);
+    transmissions_.push_back(transmission);
+    for (auto &listener : listeners_) {
+      listener(transmissions_.back());
+    }
+  }
+
+  void LoopbackReceiver::inject(const RawTimings &raw) {
+    RawTimings part;
+    for (int32_t length : raw) {
+      if (length < 0 && (uint32_t) -length >= IDLE_US) {
+        if (!part.empty()) {
+          pending_.push_back(part);
+        }
+        part.clear();
+        continue;
+      }
+      part.push_back(length);
+    }
+    if (!part.empty()) {
+      pending_.push_back(part);
+    }
+  }
+
+  void LoopbackReceiver::loop() {
+    std::vector<RawTimings> parts;
+    parts.swap(pending_);
+    for (const auto &part : parts) {
+      temp_ = part;
+      call_listeners_();
+    }
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/components/remote_base/remote_base.h"
+
+namespace ir_light_test {
+  using esphome::remote_base::RawTimings;
+
+  // One call to perform() on a transmitter
+  struct Transmission {
+    uint64_t start_us;
+    uint64_t duration_us;
+    uint32_t carrier_frequency;
+    RawTimings raw;
+  };
+
+  // An NEC frame or repeat code found in a transmission
+  struct IrCode {
+    // Offset from the start of the transmission
+    uint64_t offset_us;
+    uint64_t duration_us;
+    bool repeat;
+    uint16_t address;
+    uint16_t command;
+  };
+
+  // Raw timings of one NEC frame, as a remote sends it
+  RawTimings encode_nec(uint16_t address, uint16_t command);
+  // Raw timings of the NEC repeat code a remote sends while a button is held
+  RawTimings encode_nec_repeat();
+
+  // Split raw timings into the NEC frames and repeat codes they contain.
+  // Anything that isn't a complete code is skipped.
+  std::vector<IrCode> split_codes(const RawTimings &raw);
+
+  // A transmitter that blocks for as long as the real one would, by
+  // advancing the virtual clock by the length of the data, and keeps
+  // everything it sent
+  class RecordingTransmitter : public esphome::remote_base::RemoteTransmitterBase {
+  public:
+    const std::vector<Transmission> &transmissions() const { return transmissions_; }
+    void clear() { transmissions_.clear(); }
+    // Called with every transmission once it is out
+    void add_listener(std::function<void(const Transmission &)> listener) { listeners_.push_back(std::move(listener)); }
+
+  protected:
+    void send_internal(uint32_t send_times, uint32_t send_wait) override;
+
+    std::vector<Transmission> transmissions_;
+    std::vector<std::function<void(const Transmission &)>> listeners_;
+  };
+
+  // A receiver fed with raw signals. Like the real receiver, it splits the signal where it goes idle and hands each part to the
+  // listeners from its own loop(), after the transmission has ended.
+  class LoopbackReceiver : public esphome::remote_base::RemoteReceiverBase, public esphome::Component {
+  public:
+    // Quiet time that ends a received signal, as remote_receiver's idle
+    static const uint32_t IDLE_US = 10000;
+
+    // Queue a received signal, either a transmitter's own or a remote's
+    void inject(const RawTimings &raw);
+    void loop() override;
+
+  protected:
+    std::vector<RawTimings> pending_;
+  };
+}
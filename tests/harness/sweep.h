@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "light_rig.h"
+
+namespace ir_light_test {
+  struct SweepResult {
+    RunMetrics metrics;
+    // States after which the tracked device state didn't match the target
+    int unreached{0};
+  };
+
+  // Every point of a grid of brightness and color temperature values, in a
+  // shuffled order
+  template<typename Profile> std::vector<std::pair<float, float>> sweep_points(uint32_t seed) {
+    static const int BRIGHTNESS_STEPS = 20;
+    static const int COLOR_STEPS = 8;
+    std::vector<std::pair<float, float>> points;
+    for (int b = 0; b <= BRIGHTNESS_STEPS; ++b) {
+      for (int c = 0; c <= COLOR_STEPS; ++c) {
+        float mireds = Profile::MIN_MIREDS + (Profile::MAX_MIREDS - Profile::MIN_MIREDS) * c / COLOR_STEPS;
+        points.emplace_back((float) b / BRIGHTNESS_STEPS, mireds);
+      }
+    }
+    std::mt19937 rng(seed);
+    std::shuffle(points.begin(), points.end(), rng);
+    return points;
+  }
+
+  // Set a light to every point of the grid, letting it settle after each
+  template<typename Profile>
+  SweepResult sweep(uint32_t seed, const std::function<void(TestOutput<Profile> *)> &configure = {}) {
+    Rig rig;
+    auto *light = rig.template add_light<Profile>("sweep");
+    if (configure) {
+      configure(light);
+    }
+    rig.setup();
+
+    SweepResult result;
+    for (const auto &point : sweep_points<Profile>(seed)) {
+      rig.set(light, point.first, point.second);
+      rig.run_until_idle();
+      if (!light->remaining().empty()) {
+        result.unreached++;
+      }
+    }
+    result.metrics = rig.metrics();
+    return result;
+  }
+
+  // Slow fades between random points, with a new state written every main
+  // loop like a light transition does, so most states are superseded
+  template<typename Profile>
+  SweepResult fade(uint32_t seed, int fades, uint32_t fade_ms,
+                   const std::function<void(TestOutput<Profile> *)> &configure = {}) {
+    Rig rig;
+    auto *light = rig.template add_light<Profile>("fade");
+    if (configure) {
+      configure(light);
+    }
+    rig.setup();
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> brightness(0.05f, 1.0f);
+    std::uniform_real_distribution<float> color(Profile::MIN_MIREDS, Profile::MAX_MIREDS);
+    float from_b = brightness(rng), from_c = color(rng);
+    rig.set(light, from_b, from_c);
+    rig.run_until_idle();
+
+    SweepResult result;
+    for (int i = 0; i < fades; ++i) {
+      float to_b = brightness(rng), to_c = color(rng);
+      uint64_t start = VirtualClock::now_us();
+      uint64_t length = (uint64_t) fade_ms * 1000;
+      while (VirtualClock::now_us() - start < length) {
+        float t = (float) (VirtualClock::now_us() - start) / length;
+        rig.set(light, from_b + (to_b - from_b) * t, from_c + (to_c - from_c) * t);
+        rig.step();
+      }
+      rig.set(light, to_b, to_c);
+      rig.run_until_idle();
+      if (!light->remaining().empty()) {
+        result.unreached++;
+      }
+      from_b = to_b;
+      from_c = to_c;
+    }
+    result.metrics = rig.metrics();
+    return result;
+  }
+}
@@ -0,0 +1,62 @@
+#include "trace_replay.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace ir_light_test {
+  bool parse_trace_line(const std::string &line, TraceLine *out) {
+    size_t start = line.find("trace,");
+    if (start == std::string::npos) {
+      return false;
+    }
+
+    unsigned time, mireds, brightness, applied, count;
+    int consumed = 0;
+    if (sscanf(line.c_str() + start, "trace,%u,%u,%u,%u,%u,%n", &time, &mireds, &brightness, &applied, &count,
+               &consumed) != 5 ||
+        consumed == 0) {
+      return false;
+    }
+
+    out->time = time;
+    out->mireds = mireds;
+    out->brightness = brightness;
+    out->applied = applied != 0;
+    out->command_count = count;
+    out->commands.clear();
+
+    const char *pos = line.c_str() + start + consumed;
+    char *end;
+    for (unsigned long command = strtoul(pos, &end, 16); end != pos; command = strtoul(pos, &end, 16)) {
+      out->commands.push_back(command);
+      pos = end;
+    }
+    return true;
+  }
+
+  std::vector<TraceLine> parse_trace(std::istream &in) {
+    std::vector<TraceLine> trace;
+    std::string line;
+    TraceLine parsed;
+    while (std::getline(in, line)) {
+      if (parse_trace_line(line, &parsed)) {
+        trace.push_back(parsed);
+      }
+    }
+    return trace;
+  }
+
+  void compare_traces(const std::vector<TraceLine> &recorded, ReplayResult *result) {
+    for (size_t i = 0; i < recorded.size(); ++i) {
+      if (i >= result->replayed.size()) {
+        result->changed_plans++;
+        continue;
+      }
+      const TraceLine &a = recorded[i];
+      const TraceLine &b = result->replayed[i];
+      if (a.applied != b.applied || (a.applied && (a.command_count != b.command_count || a.commands != b.commands))) {
+        result->changed_plans++;
+      }
+    }
+  }
+}
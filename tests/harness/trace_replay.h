@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "esphome/core/log.h"
+#include "light_rig.h"
+
+namespace ir_light_test {
+  // One record of a light's trace, as ir_light_base.dump_trace logs it:
+  //   trace,<time ms>,<mireds>,<brightness>,<applied>,<command count>,<commands in hex>
+  struct TraceLine {
+    uint32_t time;
+    uint16_t mireds;
+    // Gamma corrected, scaled to 0-65535
+    uint16_t brightness;
+    bool applied;
+    uint8_t command_count;
+    // The commands kept in the record, at most TRACE_COMMANDS of them
+    std::vector<uint16_t> commands;
+  };
+
+  // Parse a trace line, which may be embedded in a log line with its
+  // prefix. Returns false for anything else.
+  bool parse_trace_line(const std::string &line, TraceLine *out);
+  // Every trace line in a captured log
+  std::vector<TraceLine> parse_trace(std::istream &in);
+
+  struct ReplayResult {
+    RunMetrics metrics;
+    uint32_t states{0};
+    // Commands planned for the applied states, as recorded and as replayed
+    uint32_t recorded_commands{0};
+    uint32_t replayed_commands{0};
+    // Records planned differently, or applied in one run and not the other
+    uint32_t changed_plans{0};
+    // Latency from a state being set to the end of its frames, over the
+    // states that sent frames before being superseded
+    uint32_t settled{0};
+    uint64_t total_latency_us{0};
+    uint64_t worst_latency_us{0};
+    // The trace of the replay, for comparing runs record by record
+    std::vector<TraceLine> replayed;
+  };
+
+  // Count the records planned differently in two traces of the same states
+  void compare_traces(const std::vector<TraceLine> &recorded, ReplayResult *result);
+
+  // Feed a captured trace through a light driven by the given profile,
+  // writing each state at its recorded time, and compare what the light
+  // plans and sends with what the trace recorded
+  template<typename Profile>
+  ReplayResult replay(const std::vector<TraceLine> &trace,
+                      const std::function<void(TestOutput<Profile> *)> &configure = {}) {
+    ReplayResult result;
+    if (trace.empty()) {
+      return result;
+    }
+
+    Rig rig;
+    rig.set_loopback(false);
+    auto *light = rig.template add_light<Profile>("replay");
+    light->set_trace_size(trace.size());
+    if (configure) {
+      configure(light);
+    }
+    rig.setup();
+    RecordingTransmitter *transmitter = rig.transmitter();
+    float gamma = rig.light_state(light)->get_gamma_correct();
+
+    bool waiting = false;
+    uint64_t set_at = 0;
+    size_t sent_before = 0;
+    auto check_settled = [&]() {
+      if (!waiting || !rig.idle()) {
+        return;
+      }
+      waiting = false;
+      if (transmitter->transmissions().size() == sent_before) {
+        return;
+      }
+      const Transmission &last = transmitter->transmissions().back();
+      uint64_t latency = last.start_us + last.duration_us - set_at;
+      result.settled++;
+      result.total_latency_us += latency;
+      if (latency > result.worst_latency_us) {
+        result.worst_latency_us = latency;
+      }
+    };
+
+    uint64_t start = VirtualClock::now_us();
+    for (const TraceLine &line : trace) {
+      uint64_t due = start + (uint64_t) (line.time - trace.front().time) * 1000;
+      while (VirtualClock::now_us() < due) {
+        rig.step();
+        check_settled();
+      }
+
+      float brightness = line.brightness / 65535.0f;
+      rig.set(light, brightness > 0.0f ? powf(brightness, 1.0f / gamma) : 0.0f, line.mireds);
+      waiting = true;
+      set_at = VirtualClock::now_us();
+      sent_before = transmitter->transmissions().size();
+      result.states++;
+      if (line.applied) {
+        result.recorded_commands += line.command_count;
+      }
+    }
+    while (waiting) {
+      rig.step();
+      check_settled();
+    }
+    rig.run_until_idle();
+    result.metrics = rig.metrics();
+
+    esphome::set_log_listener([&](int level, const char *tag, const char *message) {
+      TraceLine line;
+      if (parse_trace_line(message, &line)) {
+        result.replayed.push_back(line);
+      }
+    });
+    light->dump_trace();
+    esphome::set_log_listener(nullptr);
+
+    for (const TraceLine &line : result.replayed) {
+      if (line.applied) {
+        result.replayed_commands += line.command_count;
+      }
+    }
+    compare_traces(trace, &result);
+    return result;
+  }
+}
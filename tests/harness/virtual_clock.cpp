@@ -0,0 +1,17 @@
+#include "virtual_clock.h"
+
+#include "esphome/core/hal.h"
+
+namespace ir_light_test {
+  uint64_t VirtualClock::now_us_ = VirtualClock::START_US;
+  std::vector<uint32_t> VirtualClock::delays_;
+}
+
+namespace esphome {
+  using ir_light_test::VirtualClock;
+
+  uint32_t millis() { return VirtualClock::now_ms(); }
+  uint32_t micros() { return VirtualClock::now_us(); }
+  void delay(uint32_t ms) { VirtualClock::record_delay(ms * 1000); }
+  void delayMicroseconds(uint32_t us) { VirtualClock::record_delay(us); }
+}
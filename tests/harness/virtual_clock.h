@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ir_light_test {
+  // The clock behind millis(), micros() and delay() on the host. It only
+  // moves when the harness advances it, or when code under test blocks in
+  // delay() or on a transmission.
+  class VirtualClock {
+  public:
+    static uint64_t now_us() { return now_us_; }
+    static uint32_t now_ms() { return now_us_ / 1000; }
+    static void advance_us(uint64_t us) { now_us_ += us; }
+    static void advance_ms(uint32_t ms) { now_us_ += (uint64_t) ms * 1000; }
+
+    // Every delay() and delayMicroseconds() made, in microseconds
+    static const std::vector<uint32_t> &delays() { return delays_; }
+    static void record_delay(uint32_t us) {
+      delays_.push_back(us);
+      now_us_ += us;
+    }
+
+    // Back to the start time, a second in, so nothing sees a zero
+    // timestamp as recent
+    static void reset() {
+      now_us_ = START_US;
+      delays_.clear();
+    }
+
+    static const uint64_t START_US = 1000000;
+
+  protected:
+    static uint64_t now_us_;
+    static std::vector<uint32_t> delays_;
+  };
+}
@@ -0,0 +1,121 @@
+// Replays a trace captured with ir_light_base.dump_trace through the
+// current drivers, and compares what they plan and send with the trace:
+//
+//   replay_trace <nec_light|sara_light|photo_light> <log file> [options]
+//
+// Options override the light's settings for the replay:
+//   --channel=N --hold-repeats=N --transmit-interval=MS --max-batch-gap=MS
+//   --brightness-hysteresis=X --color-hysteresis=MIREDS --round-brightness
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+#include "harness/trace_replay.h"
+
+using namespace ir_light_test;
+
+struct Settings {
+  int channel{1};
+  int hold_repeats{0};
+  int transmit_interval{0};
+  int max_batch_gap{0};
+  float brightness_hysteresis{0.0f};
+  float color_hysteresis{0.0f};
+  bool round_brightness{false};
+};
+
+static bool parse_option(const char *arg, Settings *settings) {
+  auto value = [&](const char *name) -> const char * {
+    size_t length = strlen(name);
+    return strncmp(arg, name, length) == 0 && arg[length] == '=' ? arg + length + 1 : nullptr;
+  };
+  const char *v;
+  if ((v = value("--channel"))) {
+    settings->channel = atoi(v);
+  } else if ((v = value("--hold-repeats"))) {
+    settings->hold_repeats = atoi(v);
+  } else if ((v = value("--transmit-interval"))) {
+    settings->transmit_interval = atoi(v);
+  } else if ((v = value("--max-batch-gap"))) {
+    settings->max_batch_gap = atoi(v);
+  } else if ((v = value("--brightness-hysteresis"))) {
+    settings->brightness_hysteresis = atof(v);
+  } else if ((v = value("--color-hysteresis"))) {
+    settings->color_hysteresis = atof(v);
+  } else if (strcmp(arg, "--round-brightness") == 0) {
+    settings->round_brightness = true;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template<typename Profile> static ReplayResult run(const std::vector<TraceLine> &trace, const Settings &settings) {
+  return replay<Profile>(trace, [&](TestOutput<Profile> *light) {
+    light->set_channel(settings.channel);
+    light->set_hold_repeats(settings.hold_repeats);
+    light->set_transmit_interval(settings.transmit_interval);
+    light->set_max_batch_gap(settings.max_batch_gap);
+    light->set_brightness_hysteresis(settings.brightness_hysteresis);
+    light->set_color_hysteresis(settings.color_hysteresis);
+    light->set_round_brightness(settings.round_brightness);
+  });
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <nec_light|sara_light|photo_light> <log file> [options]\n", argv[0]);
+    return 2;
+  }
+  Settings settings;
+  for (int i = 3; i < argc; ++i) {
+    if (!parse_option(argv[i], &settings)) {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  std::ifstream file(argv[2]);
+  if (!file) {
+    fprintf(stderr, "can't read %s\n", argv[2]);
+    return 2;
+  }
+  std::vector<TraceLine> trace = parse_trace(file);
+  if (trace.empty()) {
+    fprintf(stderr, "no trace lines in %s\n", argv[2]);
+    return 1;
+  }
+
+  std::string profile = argv[1];
+  ReplayResult result;
+  if (profile == "nec_light") {
+    result = run<esphome::nec_light::NecProfile>(trace, settings);
+  } else if (profile == "sara_light") {
+    result = run<esphome::sara_light::SaraProfile>(trace, settings);
+  } else if (profile == "photo_light") {
+    result = run<esphome::photo_light::PhotoProfile>(trace, settings);
+  } else {
+    fprintf(stderr, "unknown light %s\n", argv[1]);
+    return 2;
+  }
+
+  printf("states:             %u over %.1f s\n", result.states, (trace.back().time - trace.front().time) / 1000.0);
+  printf("commands planned:   %u recorded, %u replayed\n", result.recorded_commands, result.replayed_commands);
+  printf("plans changed:      %u\n", result.changed_plans);
+  printf("frames sent:        %u (+%u repeat codes) in %u transmissions\n", result.metrics.frames,
+         result.metrics.repeats, result.metrics.transmissions);
+  printf("main loop blocked:  %.1f ms total, %.1f ms worst\n", result.metrics.blocked_us / 1000.0,
+         result.metrics.worst_block_us / 1000.0);
+  if (result.settled > 0) {
+    printf("latency:            %.1f ms mean, %.1f ms worst over %u settled states\n",
+           result.total_latency_us / 1000.0 / result.settled, result.worst_latency_us / 1000.0, result.settled);
+  }
+  return 0;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "esphome/components/light/light_state.h"
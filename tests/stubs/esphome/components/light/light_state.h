@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <set>
+
+#include "esphome/core/component.h"
+#include "esphome/core/optional.h"
+
+namespace esphome {
+  namespace light {
+    enum class ColorMode : uint8_t {
+      UNKNOWN,
+      ON_OFF,
+      BRIGHTNESS,
+      COLOR_TEMPERATURE,
+    };
+
+    class LightTraits {
+    public:
+      void set_supported_color_modes(std::set<ColorMode> modes) { modes_ = modes; }
+      float get_min_mireds() const { return min_mireds_; }
+      void set_min_mireds(float min_mireds) { min_mireds_ = min_mireds; }
+      float get_max_mireds() const { return max_mireds_; }
+      void set_max_mireds(float max_mireds) { max_mireds_ = max_mireds; }
+
+    protected:
+      std::set<ColorMode> modes_;
+      float min_mireds_{0};
+      float max_mireds_{0};
+    };
+
+    inline float gamma_correct(float value, float gamma) {
+      if (value <= 0.0f) {
+        return 0.0f;
+      }
+      if (gamma <= 0.0f) {
+        return value;
+      }
+      return powf(value, gamma);
+    }
+
+    // The values of a color temperature light, as LightColorValues keeps them
+    class LightColorValues {
+    public:
+      float get_state() const { return state_; }
+      void set_state(float state) { state_ = state; }
+      float get_brightness() const { return brightness_; }
+      void set_brightness(float brightness) { brightness_ = brightness; }
+      float get_color_temperature() const { return color_temperature_; }
+      void set_color_temperature(float color_temperature) { color_temperature_ = color_temperature; }
+
+    protected:
+      float state_{0.0f};
+      float brightness_{1.0f};
+      float color_temperature_{0.0f};
+    };
+
+    class LightState;
+
+    class LightOutput {
+    public:
+      virtual ~LightOutput() = default;
+      virtual LightTraits get_traits() = 0;
+      virtual void setup_state(LightState *state) {}
+      virtual void write_state(LightState *state) = 0;
+    };
+
+    // Calls apply immediately, without a transition, and write the new state
+    // to the output like the light's next loop would
+    class LightCall {
+    public:
+      explicit LightCall(LightState *parent) : parent_(parent) {}
+      LightCall &set_state(bool state) {
+        state_ = state;
+        return *this;
+      }
+      LightCall &set_brightness(float brightness) {
+        brightness_ = brightness;
+        return *this;
+      }
+      LightCall &set_color_temperature(float color_temperature) {
+        color_temperature_ = color_temperature;
+        return *this;
+      }
+      LightCall &set_transition_length(uint32_t transition_length) { return *this; }
+      void perform();
+
+    protected:
+      LightState *parent_;
+      optional<bool> state_;
+      optional<float> brightness_;
+      optional<float> color_temperature_;
+    };
+
+    class LightState : public EntityBase, public Component {
+    public:
+      explicit LightState(LightOutput *output) : output_(output) {}
+
+      LightOutput *get_output() const { return output_; }
+      LightTraits get_traits() { return output_->get_traits(); }
+      float get_gamma_correct() const { return gamma_correct_; }
+      void set_gamma_correct(float gamma_correct) { gamma_correct_ = gamma_correct; }
+      void setup() override { output_->setup_state(this); }
+
+      void current_values_as_brightness(float *brightness) {
+        *brightness = gamma_correct(current_values.get_state() * current_values.get_brightness(), gamma_correct_);
+      }
+
+      void current_values_as_ct(float *color_temperature, float *white_brightness) {
+        LightTraits traits = get_traits();
+        *color_temperature = (current_values.get_color_temperature() - traits.get_min_mireds()) /
+                             (traits.get_max_mireds() - traits.get_min_mireds());
+        current_values_as_brightness(white_brightness);
+      }
+
+      LightCall make_call() { return LightCall(this); }
+
+      // Number of calls made by the output, e.g. to publish a state changed
+      // by the remote
+      int calls{0};
+
+      LightColorValues current_values;
+      LightColorValues remote_values;
+
+    protected:
+      LightOutput *output_;
+      float gamma_correct_{2.8f};
+    };
+
+    inline void LightCall::perform() {
+      LightColorValues &values = parent_->current_values;
+      if (state_.has_value()) {
+        values.set_state(*state_ ? 1.0f : 0.0f);
+      }
+      if (brightness_.has_value()) {
+        values.set_brightness(*brightness_);
+      }
+      if (color_temperature_.has_value()) {
+        values.set_color_temperature(*color_temperature_);
+      }
+      parent_->remote_values = values;
+      parent_->calls++;
+      parent_->get_output()->write_state(parent_);
+    }
+  }
+}
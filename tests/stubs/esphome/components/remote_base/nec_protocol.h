@@ -0,0 +1,20 @@
+#pragma once
+
+#include "esphome/components/remote_base/remote_base.h"
+
+namespace esphome {
+  namespace remote_base {
+    struct NECData {
+      uint16_t address;
+      uint16_t command;
+      uint16_t command_repeats{1};
+    };
+
+    class NECProtocol {
+    public:
+      // Decodes one complete NEC frame from the start of the data, within
+      // the data's tolerance. Repeat codes alone aren't frames.
+      optional<NECData> decode(RemoteReceiveData src);
+    };
+  }
+}
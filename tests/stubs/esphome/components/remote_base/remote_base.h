@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/optional.h"
+
+namespace esphome {
+  namespace remote_base {
+    using RawTimings = std::vector<int32_t>;
+
+    // Marks positive, spaces negative, in microseconds
+    class RemoteTransmitData {
+    public:
+      void mark(uint32_t length) { data_.push_back(length); }
+      void space(uint32_t length) { data_.push_back(-(int32_t) length); }
+      void reserve(uint32_t len) { data_.reserve(len); }
+      void set_carrier_frequency(uint32_t carrier_frequency) { carrier_frequency_ = carrier_frequency; }
+      uint32_t get_carrier_frequency() const { return carrier_frequency_; }
+      const RawTimings &get_data() const { return data_; }
+      void reset() {
+        data_.clear();
+        carrier_frequency_ = 0;
+      }
+
+    protected:
+      RawTimings data_;
+      uint32_t carrier_frequency_{0};
+    };
+
+    class RemoteReceiveData {
+    public:
+      RemoteReceiveData(const RawTimings &data, uint8_t tolerance) : data_(data), tolerance_(tolerance) {}
+      const RawTimings &get_raw_data() const { return data_; }
+      uint8_t get_tolerance() const { return tolerance_; }
+      bool peek_mark(uint32_t length, uint32_t offset = 0) const { return peek_(length, offset, true); }
+      bool peek_space(uint32_t length, uint32_t offset = 0) const { return peek_(length, offset, false); }
+
+    protected:
+      bool peek_(uint32_t length, uint32_t offset, bool mark) const {
+        if (offset >= data_.size() || (data_[offset] > 0) != mark) {
+          return false;
+        }
+        uint32_t value = mark ? data_[offset] : -data_[offset];
+        return value >= length * (100 - tolerance_) / 100 && value <= length * (100 + tolerance_) / 100;
+      }
+
+      const RawTimings &data_;
+      uint8_t tolerance_;
+    };
+
+    // As in ESPHome, a transmit call fills the transmitter's own buffer and
+    // perform() hands it to send_internal(), which blocks until it is sent
+    class RemoteTransmitterBase {
+    public:
+      virtual ~RemoteTransmitterBase() = default;
+
+      class TransmitCall {
+      public:
+        explicit TransmitCall(RemoteTransmitterBase *parent) : parent_(parent) {}
+        RemoteTransmitData *get_data() { return &parent_->temp_; }
+        void set_send_times(uint32_t send_times) { send_times_ = send_times; }
+        void set_send_wait(uint32_t send_wait) { send_wait_ = send_wait; }
+        void perform() { parent_->send_internal(send_times_, send_wait_); }
+
+      protected:
+        RemoteTransmitterBase *parent_;
+        uint32_t send_times_{1};
+        uint32_t send_wait_{0};
+      };
+
+      TransmitCall transmit() {
+        temp_.reset();
+        return TransmitCall(this);
+      }
+
+    protected:
+      virtual void send_internal(uint32_t send_times, uint32_t send_wait) = 0;
+
+      RemoteTransmitData temp_;
+    };
+
+    class RemoteReceiverListener {
+    public:
+      virtual ~RemoteReceiverListener() = default;
+      virtual bool on_receive(RemoteReceiveData data) = 0;
+    };
+
+    class RemoteReceiverBase {
+    public:
+      void register_listener(RemoteReceiverListener *listener) { listeners_.push_back(listener); }
+
+    protected:
+      void call_listeners_() {
+        for (auto *listener : listeners_) {
+          listener->on_receive(RemoteReceiveData(temp_, tolerance_));
+        }
+      }
+
+      std::vector<RemoteReceiverListener *> listeners_;
+      RawTimings temp_;
+      uint8_t tolerance_{25};
+    };
+  }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+  namespace sensor {
+    class Sensor : public EntityBase {
+    public:
+      void publish_state(float state) {
+        this->state = state;
+        publishes++;
+        state_callback_.call(state);
+      }
+      void add_on_state_callback(std::function<void(float)> &&callback) { state_callback_.add(std::move(callback)); }
+
+      float state{0.0f};
+      int publishes{0};
+
+    protected:
+      CallbackManager<void(float)> state_callback_;
+    };
+  }
+}
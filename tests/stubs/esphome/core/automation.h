@@ -0,0 +1,27 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+  template<typename... Ts> class Trigger {
+  public:
+    void trigger(Ts... x) { count++; }
+    int count{0};
+  };
+
+  template<typename... Ts> class Action {
+  public:
+    virtual ~Action() = default;
+    virtual void play(Ts... x) = 0;
+  };
+
+  template<typename T> class Parented {
+  public:
+    Parented() {}
+    Parented(T *parent) : parent_(parent) {}
+    void set_parent(T *parent) { parent_ = parent; }
+
+  protected:
+    T *parent_{nullptr};
+  };
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+  namespace setup_priority {
+    extern const float BUS;
+    extern const float IO;
+    extern const float HARDWARE;
+    extern const float DATA;
+    extern const float PROCESSOR;
+    extern const float AFTER_CONNECTION;
+    extern const float LATE;
+  }
+
+  class Component {
+  public:
+    virtual ~Component() = default;
+    virtual void setup() {}
+    virtual void loop() {}
+    virtual void dump_config() {}
+    virtual float get_setup_priority() const { return 0.0f; }
+  };
+
+  uint32_t fnv1_hash(const std::string &str);
+
+  class EntityBase {
+  public:
+    void set_name(const char *name) { name_ = name; }
+    const char *get_name() const { return name_.c_str(); }
+    uint32_t get_object_id_hash() const { return fnv1_hash(name_); }
+
+  protected:
+    std::string name_;
+  };
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host builds have every optional integration the components use. The
+// minimal footprint variant is selected with -DUSE_IR_LIGHT_MINIMAL.
+#define USE_SENSOR
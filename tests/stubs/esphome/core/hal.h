@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Defined by the harness on top of its virtual clock
+namespace esphome {
+  uint32_t millis();
+  uint32_t micros();
+  void delay(uint32_t ms);
+  void delayMicroseconds(uint32_t us);
+
+  inline uint8_t progmem_read_byte(const uint8_t *addr) { return *addr; }
+}
+
+#define PROGMEM
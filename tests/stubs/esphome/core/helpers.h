@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+  template<typename... X> class CallbackManager;
+
+  template<typename... Ts> class CallbackManager<void(Ts...)> {
+  public:
+    void add(std::function<void(Ts...)> &&callback) { callbacks_.push_back(std::move(callback)); }
+    void call(Ts... args) {
+      for (auto &callback : callbacks_) {
+        callback(args...);
+      }
+    }
+
+  protected:
+    std::vector<std::function<void(Ts...)>> callbacks_;
+  };
+
+  class HighFrequencyLoopRequester {
+  public:
+    void start() {
+      if (!started_) {
+        started_ = true;
+        num_requests++;
+      }
+    }
+    void stop() {
+      if (started_) {
+        started_ = false;
+        num_requests--;
+      }
+    }
+    static bool is_high_frequency() { return num_requests > 0; }
+
+  protected:
+    bool started_{false};
+    static int num_requests;
+  };
+}
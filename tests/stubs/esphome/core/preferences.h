@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+  // Preferences kept in memory, so tests can check what was saved and
+  // restore it into a fresh light
+  class ESPPreferenceObject {
+  public:
+    ESPPreferenceObject() = default;
+    explicit ESPPreferenceObject(std::vector<uint8_t> *data) : data_(data) {}
+
+    template<typename T> bool save(const T *src) {
+      if (data_ == nullptr) {
+        return false;
+      }
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(src);
+      data_->assign(bytes, bytes + sizeof(T));
+      return true;
+    }
+
+    template<typename T> bool load(T *dest) {
+      if (data_ == nullptr || data_->size() != sizeof(T)) {
+        return false;
+      }
+      memcpy(dest, data_->data(), sizeof(T));
+      return true;
+    }
+
+  protected:
+    std::vector<uint8_t> *data_{nullptr};
+  };
+
+  class ESPPreferences {
+  public:
+    template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+      return ESPPreferenceObject(&store_[type]);
+    }
+    template<typename T> ESPPreferenceObject make_preference(uint32_t type) { return make_preference<T>(type, false); }
+    void clear() { store_.clear(); }
+
+  protected:
+    std::map<uint32_t, std::vector<uint8_t>> store_;
+  };
+
+  extern ESPPreferences *global_preferences;
+}
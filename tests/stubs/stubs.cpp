@@ -0,0 +1,117 @@
+// Definitions behind the ESPHome stubs that don't depend on the harness
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/remote_base/nec_protocol.h"
+
+namespace esphome {
+  namespace setup_priority {
+    const float BUS = 1000.0f;
+    const float IO = 900.0f;
+    const float HARDWARE = 800.0f;
+    const float DATA = 600.0f;
+    const float PROCESSOR = 400.0f;
+    const float AFTER_CONNECTION = 100.0f;
+    const float LATE = -100.0f;
+  }
+
+  uint32_t fnv1_hash(const std::string &str) {
+    uint32_t hash = 2166136261UL;
+    for (char c : str) {
+      hash *= 16777619UL;
+      hash ^= c;
+    }
+    return hash;
+  }
+
+  static ESPPreferences preferences;
+  ESPPreferences *global_preferences = &preferences;
+
+  int HighFrequencyLoopRequester::num_requests = 0;
+
+  static int log_counts[ESPHOME_LOG_LEVEL_VERY_VERBOSE + 1];
+  static std::function<void(int, const char *, const char *)> log_listener;
+
+  static int print_level() {
+    static int level = [] {
+      const char *env = getenv("IR_LIGHT_TEST_LOG");
+      return env != nullptr ? atoi(env) : ESPHOME_LOG_LEVEL_WARN;
+    }();
+    return level;
+  }
+
+  void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    log_counts[level]++;
+    if (log_listener) {
+      log_listener(level, tag, message);
+    }
+    if (level <= print_level()) {
+      static const char *const LETTERS = "-EWICDVV";
+      printf("[%c][%s:%d]: %s\n", LETTERS[level], tag, line, message);
+    }
+  }
+
+  int log_count(int level) { return log_counts[level]; }
+
+  void reset_log_counts() { memset(log_counts, 0, sizeof(log_counts)); }
+
+  void set_log_listener(std::function<void(int, const char *, const char *)> listener) {
+    log_listener = std::move(listener);
+  }
+
+  namespace remote_base {
+    static bool expect(const RawTimings &data, size_t index, int32_t length, uint8_t tolerance) {
+      if (index >= data.size() || (data[index] > 0) != (length > 0)) {
+        return false;
+      }
+      int32_t value = abs(data[index]);
+      int32_t expected = abs(length);
+      return value >= expected * (100 - tolerance) / 100 && value <= expected * (100 + tolerance) / 100;
+    }
+
+    // The same checks as ESPHome's NECProtocol::decode, with the same
+    // 9000/4500 header and 560/1690/560 bit timings
+    optional<NECData> NECProtocol::decode(RemoteReceiveData src) {
+      const RawTimings &data = src.get_raw_data();
+      uint8_t tolerance = src.get_tolerance();
+      if (!expect(data, 0, 9000, tolerance) || !expect(data, 1, -4500, tolerance)) {
+        return {};
+      }
+
+      uint32_t bits = 0;
+      for (int bit = 0; bit < 32; ++bit) {
+        size_t index = 2 + bit * 2;
+        if (!expect(data, index, 560, tolerance)) {
+          return {};
+        }
+        if (expect(data, index + 1, -1690, tolerance)) {
+          bits |= 1UL << bit;
+        } else if (!expect(data, index + 1, -560, tolerance)) {
+          return {};
+        }
+      }
+      if (!expect(data, 66, 560, tolerance)) {
+        return {};
+      }
+
+      NECData out;
+      out.address = bits & 0xffff;
+      out.command = bits >> 16;
+      out.command_repeats = 1;
+      return out;
+    }
+  }
+}
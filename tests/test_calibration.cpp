@@ -0,0 +1,241 @@
+// Gap calibration against fixtures that lose frames sent too soon after
+// the previous one: the gaps it keeps must be ones the fixture takes, close
+// to the shortest such gap, and only persist once the fixture confirmed them
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "esphome/components/ir_light_base/gap_calibration.h"
+#include "harness/fixture_cases.h"
+#include "harness/fixture_models.h"
+#include "harness/light_rig.h"
+
+using namespace ir_light_test;
+using esphome::ir_light_base::CommandGaps;
+using esphome::ir_light_base::GapSearch;
+using esphome::ir_light_base::NUM_COMMAND_TYPES;
+using esphome::ir_light_base::command_type;
+
+TEST(GapSearchTest, ConvergesOnTheShortestPassingGap) {
+  for (uint16_t threshold = 10; threshold <= 500; threshold += 7) {
+    GapSearch search;
+    search.begin(10, 500, 3);
+    while (!search.done()) {
+      search.report(search.gap() >= threshold);
+    }
+    EXPECT_EQ(search.result(), threshold);
+  }
+}
+
+TEST(GapSearchTest, OneFailureRulesOutTheGapAndBelow) {
+  GapSearch search;
+  search.begin(10, 100, 3);
+  uint16_t failed = search.gap();
+  search.report(true);
+  search.report(false);
+  while (!search.done()) {
+    EXPECT_GT(search.gap(), failed);
+    search.report(true);
+  }
+  EXPECT_GT(search.result(), failed);
+}
+
+// Allowed above the fixture's recovery time: the margin calibration adds,
+// and a ms of the millis() clock's truncation
+static const uint32_t GAP_TOLERANCE = 21;
+
+template<typename Case> class CalibrationTest : public ::testing::Test {
+protected:
+  using Profile = typename Case::Profile;
+  using State = typename Case::State;
+
+  void SetUp() override {
+    esphome::global_preferences->clear();
+    light_ = rig_.add_light<Profile>("light");
+    Case::configure(light_);
+    light_->set_gap_feedback(&feedback_);
+    rig_.setup();
+    fixture_.listen(rig_.transmitter());
+    fixture_.set_recovery([](uint16_t command) { return recovery(Profile::command_type_of(command)) * 1000; });
+  }
+
+  // The fixture needs less than the default gap, and less again after
+  // commands that change less
+  static uint32_t recovery(command_type type) {
+    static const uint32_t QUARTERS[NUM_COMMAND_TYPES] = {3, 2, 1};
+    return std::max<uint32_t>(Profile::COMMAND_GAP * QUARTERS[type] / 4, 10);
+  }
+
+  void start(const State &state) {
+    light_->set_device_state(state);
+    fixture_.set_state(Case::shows(state));
+    float brightness, mireds;
+    Profile::describe(state, light_->quantize_options(), &brightness, &mireds);
+    rig_.set(light_, brightness, mireds);
+    rig_.run_until_idle(20);
+  }
+
+  // Calibrate against the light sensor instead, publishing every
+  // interval_ms
+  void use_sensor(uint32_t interval_ms) {
+    sensor_ = std::make_unique<FixtureLightSensor<typename Case::Fixture>>(&fixture_, interval_ms);
+    sensor_feedback_.set_sensor(sensor_.get());
+    light_->set_gap_feedback(&sensor_feedback_);
+  }
+
+  // Calibrate for at most a few hours, stopping the sensor once the first
+  // trial's frames went out if stop_sensor is set
+  void calibrate(bool stop_sensor = false) {
+    uint32_t commands = fixture_.commands();
+    light_->calibrate_gap();
+    for (int seconds = 0; light_->is_calibrating() && seconds < 4 * 3600; ++seconds) {
+      rig_.run_for(1000);
+      if (sensor_ != nullptr) {
+        sensor_->set_stopped(stop_sensor && fixture_.commands() != commands);
+        sensor_->update();
+      }
+    }
+    EXPECT_FALSE(light_->is_calibrating());
+    rig_.run_until_idle(20);
+  }
+
+  // The calibrated gaps are ones the fixture takes, close to the shortest
+  ::testing::AssertionResult found_shortest_gaps() {
+    const CommandGaps &gaps = light_->command_gaps();
+    const uint32_t default_gap = Profile::COMMAND_GAP;
+    for (int type = 0; type < NUM_COMMAND_TYPES; ++type) {
+      uint32_t low = recovery((command_type) type);
+      uint32_t high = std::min(low + GAP_TOLERANCE, default_gap);
+      if (!Case::calibrates((command_type) type)) {
+        low = high = default_gap;
+      }
+      if (gaps.gaps[type] < low || gaps.gaps[type] > high) {
+        return ::testing::AssertionFailure() << "type " << type << " gap " << gaps.gaps[type] << " ms, expected "
+                                             << low << "-" << high << " ms";
+      }
+    }
+    return ::testing::AssertionSuccess();
+  }
+
+  ::testing::AssertionResult kept_default_gaps() {
+    const CommandGaps restored = restored_gaps();
+    for (int type = 0; type < NUM_COMMAND_TYPES; ++type) {
+      if (light_->command_gaps().gaps[type] != Profile::COMMAND_GAP || restored.gaps[type] != Profile::COMMAND_GAP) {
+        return ::testing::AssertionFailure() << "type " << type << " gap " << light_->command_gaps().gaps[type]
+                                             << " ms, restored " << restored.gaps[type] << " ms";
+      }
+    }
+    return ::testing::AssertionSuccess();
+  }
+
+  ::testing::AssertionResult settled() {
+    if (!light_->remaining().empty()) {
+      return ::testing::AssertionFailure() << light_->remaining().size() << " commands short of the target";
+    }
+    auto expected = Case::shows(light_->device_state());
+    if (!(fixture_.state() == expected)) {
+      return ::testing::AssertionFailure() << "fixture shows " << fixture_.state() << ", driver set " << expected;
+    }
+    return ::testing::AssertionSuccess();
+  }
+
+  // The gaps a light set up from the saved preferences starts with
+  CommandGaps restored_gaps() {
+    Rig rig;
+    TestOutput<Profile> *light = rig.add_light<Profile>("light");
+    rig.setup();
+    return light->command_gaps();
+  }
+
+  Rig rig_;
+  TestOutput<Profile> *light_{nullptr};
+  typename Case::Fixture fixture_{Case::make_fixture()};
+  FixtureGapFeedback<typename Case::Fixture> feedback_{&fixture_};
+  std::unique_ptr<FixtureLightSensor<typename Case::Fixture>> sensor_;
+  esphome::ir_light_base::SensorGapFeedback sensor_feedback_;
+  std::mt19937 rng_{25};
+};
+
+using Cases = ::testing::Types<NecCase<1, 0>, SaraCase, PhotoCase>;
+TYPED_TEST_SUITE(CalibrationTest, Cases);
+
+TYPED_TEST(CalibrationTest, KeepsTheShortestGapsTheFixtureTakes) {
+  using Profile = typename TypeParam::Profile;
+  this->start(TypeParam::calibration_start());
+  const auto started = this->light_->device_state();
+  this->calibrate();
+
+  const CommandGaps &gaps = this->light_->command_gaps();
+  EXPECT_TRUE(this->found_shortest_gaps());
+
+  // Back where calibration started, and the fixture keeps up with the
+  // calibrated gaps
+  EXPECT_TRUE(TypeParam::shows(this->light_->device_state()) == TypeParam::shows(started));
+  ASSERT_TRUE(this->settled());
+  auto targets = TypeParam::targets();
+  for (int run = 0; run < 50; ++run) {
+    const auto &target = targets[this->rng_() % targets.size()];
+    float brightness, mireds;
+    Profile::describe(target, this->light_->quantize_options(), &brightness, &mireds);
+    this->rig_.set(this->light_, brightness, mireds);
+    this->rig_.run_until_idle(20);
+    ASSERT_TRUE(this->settled()) << "run " << run;
+  }
+
+  const CommandGaps restored = this->restored_gaps();
+  for (int type = 0; type < NUM_COMMAND_TYPES; ++type) {
+    EXPECT_EQ(restored.gaps[type], gaps.gaps[type]) << "type " << type;
+  }
+}
+
+TYPED_TEST(CalibrationTest, RefusesToCalibrateWithTheLightOff) {
+  using Profile = typename TypeParam::Profile;
+  this->start(Profile::off(TypeParam::calibration_start()));
+  uint32_t commands = this->fixture_.commands();
+  this->calibrate();
+
+  EXPECT_EQ(this->fixture_.commands(), commands);
+  EXPECT_TRUE(this->kept_default_gaps());
+}
+
+// A sensor publishing every 30 s still reads the light lit after a trial
+// whose frame was lost, until its next reading
+TYPED_TEST(CalibrationTest, WaitsForTheSensorToCatchUp) {
+  this->use_sensor(30000);
+  this->start(TypeParam::calibration_start());
+  const auto started = this->light_->device_state();
+  this->calibrate();
+
+  EXPECT_TRUE(this->found_shortest_gaps());
+  EXPECT_TRUE(TypeParam::shows(this->light_->device_state()) == TypeParam::shows(started));
+  EXPECT_TRUE(this->settled());
+}
+
+TYPED_TEST(CalibrationTest, TrialsFailWhenTheSensorStops) {
+  this->use_sensor(30000);
+  this->start(TypeParam::calibration_start());
+  const auto started = this->light_->device_state();
+  this->calibrate(true);
+
+  EXPECT_TRUE(this->kept_default_gaps());
+  EXPECT_TRUE(TypeParam::shows(this->light_->device_state()) == TypeParam::shows(started));
+  EXPECT_TRUE(this->settled());
+}
+
+TYPED_TEST(CalibrationTest, GivesUpWithoutASensorReading) {
+  this->use_sensor(30000);
+  this->sensor_->set_stopped(true);
+  this->start(TypeParam::calibration_start());
+  uint32_t commands = this->fixture_.commands();
+  this->light_->calibrate_gap();
+  for (int seconds = 0; this->light_->is_calibrating() && seconds < 3600; ++seconds) {
+    this->rig_.run_for(1000);
+  }
+
+  EXPECT_FALSE(this->light_->is_calibrating());
+  EXPECT_EQ(this->fixture_.commands(), commands);
+  EXPECT_TRUE(this->kept_default_gaps());
+}
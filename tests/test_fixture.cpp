@@ -0,0 +1,90 @@
+// The simulated fixtures, fed with everything the transmitter sends, must
+// end up showing the state the driver thinks it set: from every starting
+// state to every target, and across random runs of superseding writes
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "harness/fixture_cases.h"
+#include "harness/fixture_models.h"
+#include "harness/light_rig.h"
+
+using namespace ir_light_test;
+
+template<typename Case> class FixtureTest : public ::testing::Test {
+protected:
+  using Profile = typename Case::Profile;
+  using State = typename Case::State;
+
+  void SetUp() override {
+    esphome::global_preferences->clear();
+    light_ = rig_.add_light<Profile>("light");
+    Case::configure(light_);
+    rig_.setup();
+    fixture_.listen(rig_.transmitter());
+  }
+
+  // Start from a state the driver tracks, with the fixture in a state
+  // matching it
+  void start(const State &state) {
+    light_->set_device_state(state);
+    fixture_.set_state(Case::physical(state, rng_));
+  }
+
+  void set(const State &target) {
+    float brightness, mireds;
+    Profile::describe(target, light_->quantize_options(), &brightness, &mireds);
+    rig_.set(light_, brightness, mireds);
+  }
+
+  // The driver thinks it reached the target, and the fixture shows what
+  // the driver thinks
+  ::testing::AssertionResult settled() {
+    if (!light_->remaining().empty()) {
+      return ::testing::AssertionFailure() << light_->remaining().size() << " commands short of the target";
+    }
+    auto expected = Case::shows(light_->device_state());
+    if (!(fixture_.state() == expected)) {
+      return ::testing::AssertionFailure() << "fixture shows " << fixture_.state() << ", driver set " << expected;
+    }
+    return ::testing::AssertionSuccess();
+  }
+
+  Rig rig_;
+  TestOutput<Profile> *light_{nullptr};
+  typename Case::Fixture fixture_{Case::make_fixture()};
+  std::mt19937 rng_{24};
+};
+
+using Cases = ::testing::Types<NecCase<1, 0>, NecCase<2, 2>, SaraCase, PhotoCase>;
+TYPED_TEST_SUITE(FixtureTest, Cases);
+
+TYPED_TEST(FixtureTest, EveryStartReachesEveryTarget) {
+  for (const auto &from : TypeParam::starts()) {
+    for (const auto &to : TypeParam::targets()) {
+      this->start(from);
+      this->set(to);
+      this->rig_.run_until_idle(20);
+      ASSERT_TRUE(this->settled());
+    }
+    this->rig_.transmitter()->clear();
+  }
+}
+
+TYPED_TEST(FixtureTest, SupersededWritesLeaveTheFixtureInStep) {
+  auto starts = TypeParam::starts();
+  auto targets = TypeParam::targets();
+  for (int run = 0; run < 200; ++run) {
+    this->start(starts[this->rng_() % starts.size()]);
+    // Writes often come before the previous one's frames are all out
+    int writes = 1 + this->rng_() % 5;
+    for (int i = 0; i < writes; ++i) {
+      this->set(targets[this->rng_() % targets.size()]);
+      this->rig_.run_for(this->rng_() % 600);
+    }
+    this->rig_.run_until_idle(20);
+    ASSERT_TRUE(this->settled()) << "run " << run;
+    this->rig_.transmitter()->clear();
+  }
+}
@@ -0,0 +1,49 @@
+// Reports the memory the precomputed frames and the trace take, so the
+// normal and minimal_footprint builds can be compared. On ESP8266 the frame
+// tables are kept in flash, the trace records in RAM.
+
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include "esphome/components/ir_light_base/nec_frame.h"
+#include "esphome/components/ir_light_base/trace.h"
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+
+using esphome::ir_light_base::NecFrameTimings;
+using esphome::ir_light_base::TraceRecord;
+
+#ifdef USE_IR_LIGHT_MINIMAL
+static const char *const BUILD = "minimal";
+#else
+static const char *const BUILD = "normal";
+#endif
+
+template<typename Profile> class FootprintTest : public ::testing::Test {};
+
+using Profiles = ::testing::Types<esphome::nec_light::NecProfile, esphome::sara_light::SaraProfile,
+                                  esphome::photo_light::PhotoProfile>;
+TYPED_TEST_SUITE(FootprintTest, Profiles);
+
+TYPED_TEST(FootprintTest, FrameTables) {
+  size_t bytes = TypeParam::FRAME_TABLE_BYTES;
+  printf("%-13s %-7s frame_tables=%zu bytes\n", TypeParam::TAG, BUILD, bytes);
+  this->RecordProperty("frame_table_bytes", (int) bytes);
+  EXPECT_GE(bytes, sizeof(uint16_t) + sizeof(NecFrameTimings));
+}
+
+TEST(FootprintTest, FrameAndTraceRecord) {
+  printf("%-13s %-7s frame=%zu bytes trace_record=%zu bytes\n", "ir_light_base", BUILD, sizeof(NecFrameTimings),
+         sizeof(TraceRecord));
+  RecordProperty("frame_bytes", (int) sizeof(NecFrameTimings));
+  RecordProperty("trace_record_bytes", (int) sizeof(TraceRecord));
+
+#ifdef USE_IR_LIGHT_MINIMAL
+  // Only the 32 bits of the frame are kept, the timings are built when sent
+  EXPECT_EQ(sizeof(NecFrameTimings), sizeof(uint32_t));
+#else
+  EXPECT_EQ(sizeof(NecFrameTimings), esphome::ir_light_base::NEC_FRAME_LENGTH * sizeof(int16_t));
+#endif
+}
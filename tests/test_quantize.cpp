@@ -0,0 +1,99 @@
+// Quantizing light values onto device levels: described states quantize
+// back to themselves, and hysteresis saves frames on values that hover
+// around a level boundary
+
+#include <cmath>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include "esphome/components/ir_light_base/quantize.h"
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+#include "esphome/core/log.h"
+#include "harness/sweep.h"
+
+using namespace ir_light_test;
+using esphome::ir_light_base::uniform_level;
+using esphome::ir_light_base::uniform_value;
+
+TEST(UniformLevelTest, ValuesMapBackOntoTheirLevel) {
+  for (bool round : {false, true}) {
+    for (int level = 0; level < 10; ++level) {
+      float value = uniform_value(level, 10, round);
+      EXPECT_GT(value, 0.0f);
+      EXPECT_EQ(uniform_level(value, 10, round, -1, 0.0f), level) << "round=" << round;
+      for (int previous : {level - 1, level + 1}) {
+        EXPECT_EQ(uniform_level(value, 10, round, previous, 0.02f), level) << "round=" << round;
+      }
+    }
+  }
+}
+
+template<typename Profile> class QuantizeTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    esphome::global_preferences->clear();
+    esphome::reset_log_counts();
+  }
+};
+
+using Profiles = ::testing::Types<esphome::nec_light::NecProfile, esphome::sara_light::SaraProfile,
+                                  esphome::photo_light::PhotoProfile>;
+TYPED_TEST_SUITE(QuantizeTest, Profiles);
+
+// Publishing a state back to the light, as a remote frame does, goes
+// through the light's gamma correction and quantizer again. It must land on
+// the same state and send nothing.
+TYPED_TEST(QuantizeTest, DescribedStatesQuantizeBack) {
+  for (bool round : {false, true}) {
+    Rig rig;
+    rig.set_loopback(false);
+    auto *light = rig.template add_light<TypeParam>("light");
+    light->set_round_brightness(round);
+    light->set_brightness_hysteresis(0.02f);
+    rig.setup();
+
+    for (const auto &point : sweep_points<TypeParam>(5)) {
+      rig.set(light, point.first, point.second);
+      rig.run_until_idle();
+      auto reached = light->device_state();
+      uint32_t frames = rig.metrics().frames;
+
+      light->publish_device_state();
+      rig.run_until_idle();
+      EXPECT_EQ(rig.metrics().frames, frames) << "round=" << round << " brightness=" << point.first
+                                              << " mireds=" << point.second;
+      EXPECT_EQ(memcmp(&reached, &light->device_state(), sizeof(reached)), 0);
+    }
+  }
+}
+
+// Values nudged back and forth across a level boundary, the way adaptive
+// lighting automations move them, with the light settling in between
+template<typename Profile> static RunMetrics hover(float brightness_hysteresis, float color_hysteresis) {
+  Rig rig;
+  auto *light = rig.template add_light<Profile>("hover");
+  light->set_brightness_hysteresis(brightness_hysteresis);
+  light->set_color_hysteresis(color_hysteresis);
+  rig.setup();
+  for (int i = 0; i < 200; ++i) {
+    // The profiles quantize gamma corrected brightness, and every one of
+    // them has a boundary at 0.5 and one near 180 mireds
+    float brightness = 0.5f + 0.04f * sinf(i * 0.7f) + 0.001f * (i % 7);
+    float mireds = 182.0f + 15.0f * sinf(i * 0.3f);
+    rig.set(light, powf(brightness, 1.0f / rig.light_state(light)->get_gamma_correct()), mireds);
+    rig.run_until_idle();
+  }
+  return rig.metrics();
+}
+
+TYPED_TEST(QuantizeTest, HysteresisReducesFrames) {
+  RunMetrics hard = hover<TypeParam>(0.0f, 0.0f);
+  RunMetrics banded = hover<TypeParam>(0.05f, 20.0f);
+  printf("%-12s hover frames: %u without hysteresis, %u with\n", TypeParam::TAG, hard.frames, banded.frames);
+  this->RecordProperty("frames_without_hysteresis", hard.frames);
+  this->RecordProperty("frames_with_hysteresis", banded.frames);
+  EXPECT_LT(banded.frames, hard.frames / 4);
+}
@@ -0,0 +1,229 @@
+// Frames from a light's physical remote, fed through the receiver or
+// straight in as decoded NECData, keep the tracked device state in sync
+
+#include <gtest/gtest.h>
+
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+#include "esphome/components/remote_base/nec_protocol.h"
+#include "esphome/core/log.h"
+#include "harness/fixture_cases.h"
+#include "harness/fixture_models.h"
+#include "harness/sweep.h"
+
+using namespace ir_light_test;
+using esphome::ir_light_base::POWER_OFF;
+using esphome::ir_light_base::POWER_ON;
+using esphome::nec_light::NecProfile;
+
+static const uint16_t NEC_MAX_WHITE = 0x52ad;
+static const uint16_t NEC_BRIGHTER = 0x45ba;
+static const uint16_t NEC_DIMMER = 0x44bb;
+static const uint16_t NEC_OFF = 0x41be;
+
+// The channel 2 code for a channel 1 code
+static uint16_t nec_channel_2(uint16_t command) { return (command | 0x8000) & ~0x0080; }
+
+class ReceiverTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    esphome::global_preferences->clear();
+    esphome::reset_log_counts();
+  }
+};
+
+TEST_F(ReceiverTest, RemoteFrameUpdatesAndPublishesState) {
+  Rig rig;
+  auto *light = rig.add_light<NecProfile>("nec");
+  rig.setup();
+
+  rig.receiver()->inject(encode_nec(NecProfile::ADDRESS, NEC_MAX_WHITE));
+  rig.run_until_idle();
+  EXPECT_EQ(light->device_state().power, POWER_ON);
+  EXPECT_EQ(light->device_state().color, esphome::nec_light::CT_NATURAL);
+  EXPECT_EQ(light->device_state().brightness, esphome::nec_light::BRT_MAX);
+
+  // The new state is published back to the light, which then has nothing
+  // to send
+  auto *state = rig.light_state(light);
+  EXPECT_EQ(state->calls, 1);
+  EXPECT_EQ(state->current_values.get_state(), 1.0f);
+  EXPECT_EQ(state->current_values.get_color_temperature(), 182.0f);
+  EXPECT_EQ(rig.metrics().frames, 0u);
+
+  rig.receiver()->inject(encode_nec(NecProfile::ADDRESS, NEC_OFF));
+  rig.run_until_idle();
+  EXPECT_EQ(light->device_state().power, POWER_OFF);
+  EXPECT_EQ(state->current_values.get_state(), 0.0f);
+  EXPECT_EQ(rig.metrics().frames, 0u);
+}
+
+TEST_F(ReceiverTest, RelativeFramesNeedAKnownState) {
+  Rig rig;
+  auto *light = rig.add_light<NecProfile>("nec");
+  rig.setup();
+
+  EXPECT_TRUE(light->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, NEC_BRIGHTER}));
+  EXPECT_FALSE(light->device_state().known());
+  EXPECT_EQ(rig.light_state(light)->calls, 0);
+
+  light->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, NEC_MAX_WHITE});
+  light->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, 0x44bb});
+  EXPECT_EQ(light->device_state().brightness, 8);
+  EXPECT_EQ(rig.light_state(light)->calls, 2);
+}
+
+// Holding a button on the remote sends one frame and then a repeat code
+// every 108 ms. The device takes every hold_repeats repeat codes as one more
+// step, as it does for the light's own held commands.
+TEST_F(ReceiverTest, HeldButtonsStepWithTheRepeatCodes) {
+  Rig rig;
+  auto *light = rig.add_light<NecProfile>("nec");
+  light->set_hold_repeats(2);
+  rig.setup();
+
+  rig.receiver()->inject(encode_nec(NecProfile::ADDRESS, NEC_MAX_WHITE));
+  rig.run_for(108);
+  rig.receiver()->inject(encode_nec(NecProfile::ADDRESS, NEC_DIMMER));
+  for (int i = 0; i < 5; ++i) {
+    rig.run_for(108);
+    rig.receiver()->inject(encode_nec_repeat());
+  }
+  rig.run_for(108);
+  EXPECT_EQ(light->device_state().brightness, esphome::nec_light::BRT_MAX - 3);
+
+  // Repeat codes after a pause, or after another device's frame, don't
+  // continue the hold
+  rig.run_for(500);
+  rig.receiver()->inject(encode_nec_repeat());
+  rig.run_for(108);
+  rig.receiver()->inject(encode_nec_repeat());
+  rig.run_for(108);
+  rig.receiver()->inject(encode_nec(NecProfile::ADDRESS, NEC_DIMMER));
+  rig.run_for(108);
+  rig.receiver()->inject(encode_nec(0x1234, NEC_DIMMER));
+  rig.run_for(108);
+  rig.receiver()->inject(encode_nec_repeat());
+  rig.receiver()->inject(encode_nec_repeat());
+  rig.run_until_idle();
+  EXPECT_EQ(light->device_state().brightness, esphome::nec_light::BRT_MAX - 4);
+  EXPECT_EQ(rig.metrics().frames, 0u);
+}
+
+// Repeat codes received along with their frame count the same
+TEST_F(ReceiverTest, RepeatsDecodedWithTheFrameStep) {
+  Rig rig;
+  auto *light = rig.add_light<NecProfile>("nec");
+  light->set_hold_repeats(2);
+  rig.setup();
+
+  light->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, NEC_MAX_WHITE});
+  light->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, NEC_DIMMER, 5});
+  EXPECT_EQ(light->device_state().brightness, esphome::nec_light::BRT_MAX - 3);
+}
+
+TEST_F(ReceiverTest, ChannelsAndAddressesAreKeptApart) {
+  Rig rig;
+  auto *one = rig.add_light<NecProfile>("one");
+  auto *two = rig.add_light<NecProfile>("two");
+  two->set_channel(2);
+  rig.setup();
+
+  EXPECT_TRUE(two->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, nec_channel_2(NEC_MAX_WHITE)}));
+  EXPECT_FALSE(one->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, nec_channel_2(NEC_MAX_WHITE)}));
+  EXPECT_FALSE(two->on_nec_received(esphome::remote_base::NECData{NecProfile::ADDRESS, NEC_MAX_WHITE}));
+  EXPECT_FALSE(one->on_nec_received(esphome::remote_base::NECData{0x1234, NEC_MAX_WHITE}));
+  EXPECT_TRUE(two->device_state().known());
+  EXPECT_FALSE(one->device_state().known());
+}
+
+TEST_F(ReceiverTest, OwnFramesAreNotAppliedTwice) {
+  Rig rig;
+  auto *light = rig.add_light<NecProfile>("nec");
+  rig.setup();
+
+  rig.set(light, 0.8f, 182.0f);
+  rig.run_until_idle();
+  rig.set(light, 0.2f, 300.0f);
+  rig.run_until_idle();
+  EXPECT_GT(rig.metrics().frames, 1u);
+  EXPECT_TRUE(light->remaining().empty());
+  EXPECT_EQ(rig.light_state(light)->calls, 2);
+}
+
+// Tint adjustments from the remote step from the current tint, as the
+// bulb does: back to the base color from the opposite tint, and no further
+// than one step from it
+TEST_F(ReceiverTest, PhotoTintStepsLikeTheBulb) {
+  using esphome::photo_light::PhotoProfile;
+  static const uint16_t WARMER = 0xf50a;
+  static const uint16_t COOLER = 0xfd02;
+  Rig rig;
+  auto *light = rig.add_light<PhotoProfile>("photo");
+  rig.setup();
+
+  for (int color = 0; color < 7; ++color) {
+    // Every sequence of one to three presses
+    for (int presses = 1; presses <= 3; ++presses) {
+      for (int sequence = 0; sequence < (1 << presses); ++sequence) {
+        PhotoProfile::State start{color, 3};
+        light->set_device_state(start);
+        PhotoFixture fixture;
+        fixture.set_state(PhotoCase::shows(start));
+        // Whether the bulb passed through a tint the driver has no setting
+        // for, after which it can't know the color
+        bool unsettable = false;
+        for (int i = 0; i < presses; ++i) {
+          uint16_t command = (sequence >> i) & 1 ? WARMER : COOLER;
+          light->on_nec_received(esphome::remote_base::NECData{PhotoProfile::ADDRESS, command});
+          fixture.receive(Transmission{0, 0, 38000, encode_nec(PhotoProfile::ADDRESS, command)});
+          const PhotoFixture::State &bulb = fixture.state();
+          unsettable |= (bulb.base == PhotoFixture::COLD && bulb.tint < 0) ||
+                        (bulb.base == PhotoFixture::WARM && bulb.tint > 0);
+        }
+
+        auto state = light->device_state();
+        EXPECT_EQ(state.known(), !unsettable) << "from " << color << ", sequence " << sequence;
+        if (state.known()) {
+          EXPECT_TRUE(PhotoCase::shows(state) == fixture.state())
+              << "from " << color << ", sequence " << sequence << ": driver " << PhotoCase::shows(state)
+              << ", bulb " << fixture.state();
+        }
+      }
+    }
+  }
+}
+
+// Every frame a light sends is one its own decoder takes back, on its
+// channel
+template<typename Profile> class DecodeTest : public ReceiverTest {};
+
+using Profiles = ::testing::Types<NecProfile, esphome::sara_light::SaraProfile, esphome::photo_light::PhotoProfile>;
+TYPED_TEST_SUITE(DecodeTest, Profiles);
+
+TYPED_TEST(DecodeTest, SentFramesDecode) {
+  for (uint8_t channel : {1, 2}) {
+    Rig rig;
+    rig.set_loopback(false);
+    auto *light = rig.template add_light<TypeParam>("light");
+    light->set_channel(channel);
+    rig.setup();
+    for (const auto &point : sweep_points<TypeParam>(4)) {
+      rig.set(light, point.first, point.second);
+      rig.run_until_idle();
+    }
+
+    for (const Transmission &transmission : rig.transmitter()->transmissions()) {
+      esphome::remote_base::RemoteReceiveData data(transmission.raw, 25);
+      auto nec = esphome::remote_base::NECProtocol().decode(data);
+      if (!nec.has_value()) {
+        // Repeat codes
+        continue;
+      }
+      uint16_t command;
+      EXPECT_EQ(nec->address, (uint16_t) TypeParam::ADDRESS);
+      EXPECT_TRUE(TypeParam::decode(nec->command, channel, &command)) << std::hex << nec->command;
+    }
+  }
+}
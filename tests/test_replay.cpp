@@ -0,0 +1,108 @@
+// Parsing dump_trace output and replaying it through the drivers
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+#include "harness/trace_replay.h"
+
+using namespace ir_light_test;
+
+TEST(TraceParseTest, ReadsLoggedLines) {
+  std::istringstream log(
+      "[I][nec_light:040]: Trace: 3 records\n"
+      "[I][nec_light:052]: trace,1234,250,32768,1,3,45BA 45BA 44BB\n"
+      "[D][light:036]: 'Light' Setting:\n"
+      "trace,1250,182,0,0,0,\n"
+      "[I][nec_light:052]: trace,1266,370,65535,1,8,51AE 57A8 57A8 57A8 57A8 57A8\n"
+      "[I][nec_light:052]: trace,1282,abc\n");
+  std::vector<TraceLine> trace = parse_trace(log);
+  ASSERT_EQ(trace.size(), 3u);
+
+  EXPECT_EQ(trace[0].time, 1234u);
+  EXPECT_EQ(trace[0].mireds, 250);
+  EXPECT_EQ(trace[0].brightness, 32768);
+  EXPECT_TRUE(trace[0].applied);
+  EXPECT_EQ(trace[0].command_count, 3);
+  EXPECT_EQ(trace[0].commands, (std::vector<uint16_t>{0x45ba, 0x45ba, 0x44bb}));
+
+  EXPECT_FALSE(trace[1].applied);
+  EXPECT_TRUE(trace[1].commands.empty());
+
+  // Only the first commands of long plans are kept
+  EXPECT_EQ(trace[2].command_count, 8);
+  EXPECT_EQ(trace[2].commands.size(), 6u);
+}
+
+template<typename Profile> class ReplayTest : public ::testing::Test {
+protected:
+  void SetUp() override { esphome::global_preferences->clear(); }
+
+  // Fades written every main loop, with whole mireds as the trace keeps
+  // them, captured through dump_trace
+  std::vector<TraceLine> capture(RunMetrics *metrics) {
+    Rig rig;
+    rig.set_loopback(false);
+    auto *light = rig.template add_light<Profile>("recorded");
+    light->set_trace_size(1000);
+    rig.setup();
+
+    for (int fade = 0; fade < 6; ++fade) {
+      float from = fade % 2 ? 1.0f : 0.1f, to = fade % 2 ? 0.1f : 1.0f;
+      for (int i = 0; i <= 40; ++i) {
+        float t = i / 40.0f;
+        rig.set(light, from + (to - from) * t, roundf(Profile::MIN_MIREDS + (Profile::MAX_MIREDS - Profile::MIN_MIREDS) * t));
+        rig.step();
+      }
+      rig.run_until_idle();
+    }
+    rig.set(light, 0.0f, Profile::MIN_MIREDS);
+    rig.run_until_idle();
+    *metrics = rig.metrics();
+
+    std::ostringstream log;
+    esphome::set_log_listener([&](int level, const char *tag, const char *message) { log << message << "\n"; });
+    light->dump_trace();
+    esphome::set_log_listener(nullptr);
+    std::istringstream in(log.str());
+    return parse_trace(in);
+  }
+};
+
+using Profiles = ::testing::Types<esphome::nec_light::NecProfile, esphome::sara_light::SaraProfile,
+                                  esphome::photo_light::PhotoProfile>;
+TYPED_TEST_SUITE(ReplayTest, Profiles);
+
+TYPED_TEST(ReplayTest, ReplayReproducesTheRecordedRun) {
+  RunMetrics recorded;
+  std::vector<TraceLine> trace = this->capture(&recorded);
+  ASSERT_EQ(trace.size(), recorded.states_set);
+
+  ReplayResult result = replay<TypeParam>(trace);
+  EXPECT_EQ(result.states, trace.size());
+  EXPECT_EQ(result.changed_plans, 0u);
+  EXPECT_EQ(result.replayed_commands, result.recorded_commands);
+  EXPECT_EQ(result.metrics.frames, recorded.frames);
+  EXPECT_GT(result.settled, 0u);
+}
+
+TYPED_TEST(ReplayTest, ReplayShowsTheEffectOfSettings) {
+  RunMetrics recorded;
+  std::vector<TraceLine> trace = this->capture(&recorded);
+
+  ReplayResult result = replay<TypeParam>(trace, [](TestOutput<TypeParam> *light) {
+    light->set_transmit_interval(500);
+  });
+  printf("%-12s replay: %u commands recorded, %u with a 500 ms transmit interval, %u plans changed, "
+         "worst latency %.1f ms\n",
+         TypeParam::TAG, result.recorded_commands, result.replayed_commands, result.changed_plans,
+         result.worst_latency_us / 1000.0);
+  // Far fewer states get planned at all
+  EXPECT_GT(result.changed_plans, 0u);
+  EXPECT_LT(result.replayed_commands, result.recorded_commands);
+}
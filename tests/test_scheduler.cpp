@@ -0,0 +1,165 @@
+// Scheduling frames and NEC repeat codes on one or more transmitters
+
+#include <gtest/gtest.h>
+
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/core/log.h"
+#include "harness/sweep.h"
+
+using namespace ir_light_test;
+using esphome::nec_light::NecProfile;
+using esphome::photo_light::PhotoProfile;
+
+static const uint64_t REPEAT_PERIOD_US = 108000;
+// How late a repeat code may start, one main loop at high frequency
+static const uint64_t REPEAT_SLACK_US = 2000;
+
+class SchedulerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    esphome::global_preferences->clear();
+    esphome::reset_log_counts();
+  }
+
+  // Every repeat code a transmitter sent must start one repeat period after
+  // the code before it
+  void expect_repeat_cadence(const RecordingTransmitter *transmitter, int *repeats) {
+    bool have_previous = false;
+    uint64_t previous = 0;
+    for (const Transmission &transmission : transmitter->transmissions()) {
+      for (const IrCode &code : split_codes(transmission.raw)) {
+        uint64_t start = transmission.start_us + code.offset_us;
+        if (code.repeat) {
+          ASSERT_TRUE(have_previous);
+          EXPECT_GE(start - previous, REPEAT_PERIOD_US);
+          EXPECT_LE(start - previous, REPEAT_PERIOD_US + REPEAT_SLACK_US);
+          (*repeats)++;
+        }
+        have_previous = true;
+        previous = start;
+      }
+    }
+  }
+
+  // Frames as address and command, repeat codes as 0
+  static std::vector<uint32_t> codes_sent(const RecordingTransmitter *transmitter) {
+    std::vector<uint32_t> codes;
+    for (const Transmission &transmission : transmitter->transmissions()) {
+      for (const IrCode &code : split_codes(transmission.raw)) {
+        codes.push_back(code.repeat ? 0 : (uint32_t) code.address << 16 | code.command);
+      }
+    }
+    return codes;
+  }
+
+  // Both lights step through their range, with held nec_light steps and
+  // photo_light adjustments followed by repeat codes. Everything sent is
+  // looped back into the receiver the lights listen to, and must not be
+  // taken for frames from their remotes.
+  void run_repeats(Rig *rig) {
+    auto *nec = rig->add_light<NecProfile>("nec");
+    nec->set_hold_repeats(2);
+    auto *photo = rig->add_light<PhotoProfile>("photo");
+    rig->setup();
+    for (const auto &point : sweep_points<NecProfile>(6)) {
+      rig->set(nec, point.first, point.second);
+      rig->set(photo, point.first, point.second * 1.5f - 100.0f);
+      rig->run_until_idle();
+      ASSERT_TRUE(nec->remaining().empty());
+      ASSERT_TRUE(photo->remaining().empty());
+    }
+    int states = sweep_points<NecProfile>(6).size();
+    EXPECT_EQ(rig->light_state(nec)->calls, states);
+    EXPECT_EQ(rig->light_state(photo)->calls, states);
+  }
+};
+
+TEST_F(SchedulerTest, RepeatCodesKeepTheirCadence) {
+  Rig rig;
+  run_repeats(&rig);
+  int repeats = 0;
+  expect_repeat_cadence(rig.transmitter(), &repeats);
+  EXPECT_GT(repeats, 0);
+}
+
+TEST_F(SchedulerTest, RepeatCodesKeepTheirCadenceOnEveryTransmitter) {
+  Rig rig(3);
+  run_repeats(&rig);
+  for (size_t i = 0; i < 3; ++i) {
+    int repeats = 0;
+    expect_repeat_cadence(rig.transmitter(i), &repeats);
+    EXPECT_EQ(repeats, rig.metrics().repeats) << "transmitter " << i;
+
+    // Every transmitter sends the same codes
+    EXPECT_EQ(codes_sent(rig.transmitter(i)), codes_sent(rig.transmitter(0))) << "transmitter " << i;
+  }
+}
+
+// on_transmit_complete fires once the light's last frames are out, after
+// the tracked state has taken all of them, also when they went out in one
+// batch
+TEST_F(SchedulerTest, TransmitCompleteFiresOnceAfterTheWholeBatch) {
+  Rig rig;
+  auto *photo = rig.add_light<PhotoProfile>("photo");
+  photo->set_max_batch_gap(50);
+  int calls = 0;
+  size_t remaining = 0;
+  photo->add_on_transmit_complete_callback([&]() {
+    calls++;
+    remaining += photo->remaining().size();
+  });
+  rig.setup();
+
+  float brightness, mireds;
+  PhotoProfile::describe(PhotoProfile::State{3, 2}, photo->quantize_options(), &brightness, &mireds);
+  rig.set(photo, brightness, mireds);
+  rig.run_until_idle();
+  EXPECT_GE(rig.metrics().frames, 2u);
+  EXPECT_EQ(rig.metrics().transmissions, 1u);
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(remaining, 0u);
+}
+
+TEST_F(SchedulerTest, TransmitCompleteFiresOncePerState) {
+  Rig rig;
+  auto *nec = rig.add_light<NecProfile>("nec");
+  int calls = 0;
+  size_t remaining = 0;
+  nec->add_on_transmit_complete_callback([&]() {
+    calls++;
+    remaining += nec->remaining().size();
+  });
+  rig.setup();
+
+  // States the light is already in send nothing, and complete nothing
+  int sending = 0;
+  for (const auto &point : sweep_points<NecProfile>(3)) {
+    uint32_t frames = rig.metrics().frames;
+    rig.set(nec, point.first, point.second);
+    rig.run_until_idle();
+    sending += rig.metrics().frames > frames;
+  }
+  EXPECT_GT(sending, 0);
+  EXPECT_EQ(calls, sending);
+  EXPECT_EQ(remaining, 0u);
+}
+
+// Repeat codes, and the copies for further transmitters, go out one per
+// loop, so no time a light reports as blocked is longer than one loop, and
+// all of them add up to the time the loops spent
+TEST_F(SchedulerTest, BlockedTimeIsCountedPerLoop) {
+  for (size_t transmitters : {1, 3}) {
+    Rig rig(transmitters);
+    auto *photo = rig.add_light<PhotoProfile>("photo");
+    rig.setup();
+    for (const auto &point : sweep_points<PhotoProfile>(6)) {
+      rig.set(photo, point.first, point.second);
+      rig.run_until_idle();
+    }
+    ASSERT_GT(rig.metrics().repeats, 0u);
+    EXPECT_GT(photo->max_blocked_us(), 0u);
+    EXPECT_LE(photo->max_blocked_us(), rig.metrics().worst_block_us) << transmitters << " transmitters";
+    EXPECT_LE(photo->blocked_us(), rig.metrics().blocked_us) << transmitters << " transmitters";
+  }
+}
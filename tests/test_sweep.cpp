@@ -0,0 +1,72 @@
+// Sweeps every profile over its range of light values and reports what the
+// frames cost: how many were sent, how long the main loop blocked, and how
+// long the light took to settle
+
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include "esphome/components/nec_light/nec_light.h"
+#include "esphome/components/photo_light/photo_light.h"
+#include "esphome/components/sara_light/sara_light.h"
+#include "esphome/core/log.h"
+#include "harness/sweep.h"
+
+using namespace ir_light_test;
+
+template<typename Profile> class SweepTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    esphome::global_preferences->clear();
+    esphome::reset_log_counts();
+  }
+
+  void report(const char *name, const SweepResult &result) {
+    const RunMetrics &m = result.metrics;
+    printf("%-12s %-6s states=%u frames=%u repeats=%u transmissions=%u blocked=%.1fms worst_block=%.1fms "
+           "worst_latency=%.1fms\n",
+           Profile::TAG, name, m.states_set, m.frames, m.repeats, m.transmissions, m.blocked_us / 1000.0,
+           m.worst_block_us / 1000.0, m.worst_latency_us / 1000.0);
+    this->RecordProperty(std::string(name) + "_frames", m.frames);
+    this->RecordProperty(std::string(name) + "_blocked_ms", m.blocked_us / 1000);
+    this->RecordProperty(std::string(name) + "_worst_latency_ms", m.worst_latency_us / 1000);
+  }
+};
+
+using Profiles = ::testing::Types<esphome::nec_light::NecProfile, esphome::sara_light::SaraProfile,
+                                  esphome::photo_light::PhotoProfile>;
+TYPED_TEST_SUITE(SweepTest, Profiles);
+
+TYPED_TEST(SweepTest, GridReachesEveryTarget) {
+  SweepResult result = sweep<TypeParam>(1);
+  this->report("grid", result);
+  EXPECT_EQ(result.unreached, 0);
+  EXPECT_GT(result.metrics.frames, 0u);
+  EXPECT_EQ(esphome::log_count(ESPHOME_LOG_LEVEL_WARN), 0);
+}
+
+TYPED_TEST(SweepTest, FadesSettleOnTheFinalState) {
+  SweepResult result = fade<TypeParam>(2, 20, 1000);
+  this->report("fade", result);
+  EXPECT_EQ(result.unreached, 0);
+  // Frames for superseded states are dropped, so a fade sends far fewer
+  // frames than it writes states
+  EXPECT_LT(result.metrics.frames, result.metrics.states_set / 2);
+  EXPECT_EQ(esphome::log_count(ESPHOME_LOG_LEVEL_WARN), 0);
+}
+
+TYPED_TEST(SweepTest, UnbatchedFramesBoundWorstBlock) {
+  SweepResult result = sweep<TypeParam>(3);
+  // Batching is off by default, so the longest the main loop blocks is one
+  // frame and its repeat codes
+  EXPECT_LT(result.metrics.worst_block_us, 100000u);
+}
+
+TYPED_TEST(SweepTest, BatchingTradesBlockingForTransmissions) {
+  SweepResult single = sweep<TypeParam>(3);
+  SweepResult batched = sweep<TypeParam>(3, [](TestOutput<TypeParam> *light) { light->set_max_batch_gap(50); });
+  this->report("batch", batched);
+  EXPECT_EQ(batched.unreached, 0);
+  EXPECT_LE(batched.metrics.transmissions, single.metrics.transmissions);
+  EXPECT_GE(batched.metrics.worst_block_us, single.metrics.worst_block_us);
+}